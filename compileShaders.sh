@@ -4,3 +4,5 @@ glslang -V shaders/flat.frag -o shaders/flat.frag.spv
 glslang -V shaders/black.frag -o shaders/black.frag.spv
 glslang -V shaders/normal.vert -o shaders/normal.vert.spv
 glslang -V shaders/normal.frag -o shaders/normal.frag.spv
+glslang -V shaders/cull.comp -o shaders/cull.comp.spv
+glslang -V shaders/model.vert -o shaders/model.vert.spv
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "fileHandler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace assetPack {
+constexpr uint32_t magicValue = 0x4B504D43; // "CMPK"
+constexpr uint32_t version = 2;
+// Every entry starts on this boundary, enough for SPIR-V words, glTF accessors and texel copies
+constexpr size_t alignment = 256;
+// All of config::textureLayers as one array image
+constexpr std::string_view blockTextures = "textures/blocks";
+
+enum class Kind : uint32_t {
+  Blob,
+  Shader,
+  Texture,
+  Model,
+};
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t alignment;
+  uint64_t indexOffset;
+  // Whole pack, a shorter file was cut off while being written
+  uint64_t size;
+};
+
+// The index is sorted by name so a lookup is a binary search over the mapping
+struct Entry {
+  char name[48];
+  uint64_t offset;
+  uint64_t size;
+  Kind kind;
+  // Textures only: RGBA8 sRGB, every level of layer 0 first, then every level of layer 1 and so on
+  uint32_t width;
+  uint32_t height;
+  uint32_t layers;
+  uint32_t mipLevels;
+  uint32_t reserved;
+  // Write time of the newest source file in nanoseconds since the Unix epoch, 0 when none was found
+  int64_t modified;
+};
+static_assert(sizeof(Entry) == 96);
+
+// Decoded textures in the same layout a packed texture has
+struct TextureData {
+  uint32_t width = 1;
+  uint32_t height = 1;
+  uint32_t layers = 1;
+  uint32_t mipLevels = 1;
+  std::vector<uint8_t> pixels;
+};
+
+size_t levelSize(uint32_t width, uint32_t height, uint32_t level);
+size_t textureSize(uint32_t width, uint32_t height, uint32_t layers, uint32_t mipLevels);
+// Box filter in linear space, half the size rounded down but never below one
+std::vector<uint8_t> downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height);
+// PNGs scaled up to the largest of them, only level 0 unless mipmapped, missing files become white layers
+TextureData decodeTextures(const std::vector<std::string>& paths, bool mipmapped);
+
+// Loose files an entry is built from, under config::assetRoot
+std::vector<std::string> sources(std::string_view name);
+// Newest write time of the files that exist, 0 when none does
+int64_t modified(const std::vector<std::string>& paths);
+
+// Read only view of a pack, entries point straight into the mapping
+class Archive {
+public:
+  fileHandler::MappedFile file;
+  std::span<const Entry> entries;
+  // Entries whose sources were written after the pack was built
+  std::vector<bool> stale;
+
+  Archive() = default;
+  Archive(const std::string& path);
+
+  bool isOpen() const;
+  // Stale entries are not found, so callers read the loose file instead
+  const Entry* find(std::string_view name) const;
+  std::span<const unsigned char> bytes(const Entry& entry) const;
+};
+
+// Next to the executable, so it does not depend on the working directory
+std::string defaultPath();
+// Shaders, block textures and the model from config::assetRoot, textures are decoded and mipmapped here
+bool build(const std::string& path);
+} // namespace assetPack
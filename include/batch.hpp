@@ -0,0 +1,51 @@
+#pragma once
+
+#include "calc.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Many points, boxes or spheres at once over separate arrays per axis, eight lanes with AVX2 and four with SSE or NEON
+namespace batch {
+enum class Path {
+  Scalar,
+  Wide,
+  Avx2,
+};
+
+// Widest path this CPU can run, AVX2 is checked at runtime so the build does not need -mavx2
+Path bestPath();
+const char* name(Path path);
+
+struct Points {
+  const float* xs;
+  const float* ys;
+  const float* zs;
+  size_t count;
+};
+
+struct Boxes {
+  const float* minX;
+  const float* minY;
+  const float* minZ;
+  const float* maxX;
+  const float* maxY;
+  const float* maxZ;
+  size_t count;
+};
+
+struct Spheres {
+  const float* xs;
+  const float* ys;
+  const float* zs;
+  const float* radii;
+  size_t count;
+};
+
+// Points have w = 1 and are not divided by the resulting w, the outputs may be the inputs
+void transformPoints(const calc::Mat4& matrix, const Points& points, float* outX, float* outY, float* outZ, Path path = bestPath());
+
+// Both write the indices of the shapes that are not fully behind any plane and return their count
+size_t boxesInside(std::span<const calc::Vec4> planes, const Boxes& boxes, std::vector<uint32_t>& inside, Path path = bestPath());
+size_t spheresInside(std::span<const calc::Vec4> planes, const Spheres& spheres, std::vector<uint32_t>& inside, Path path = bestPath());
+} // namespace batch
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace benchmark {
+// Entry points for `MineCloneCraft --bench-<name>`, they return the process exit code
+// Cave culling on a synthetic stacked graph against the chunks it has to reach, then frustum culling on the camera paths
+int frustumCulling();
+// Compute culling against the CPU culler on the camera paths, then across a release and re-upload of half the chunks
+int gpuCulling();
+// Offscreen fly-through, --hash prints a hash of every path and --png-dir=<dir> saves the last frame of each,
+// --overdraw counts fragments unsorted, sorted and with the pre-pass, culling on the CPU so the order holds
+int headless(const std::vector<std::string>& args);
+// Scripted input through the whole game loop on the null renderer, --frames=<n> and --gpu for the Vulkan one
+int gameLoop(const std::vector<std::string>& args);
+// calc kernels checked against the naive loops they replaced and the SIMD lanes against the scalar ones, then timed,
+// --check skips the timings and only exits non-zero on a difference
+int math(const std::vector<std::string>& args);
+// Batch transform and plane tests per million elements on every path the CPU has
+int batchKernels();
+// Headless frames with 10k, 100k and 1M instances of the configured model, static and moving, --frames=<n>
+int instancing(const std::vector<std::string>& args);
+// Tape parser against the flat map one on a generated glTF document, --mb=<size>
+int json(const std::vector<std::string>& args);
+// Loose files against the mapped asset pack, cold from disk and warm, for asset loading and the whole renderer init,
+// then the time to the first frame with the world generated before the renderer or next to it, --runs=<n>
+int startup(const std::vector<std::string>& args);
+
+// Swept AABB steps of walking, falling and jumping bodies on the generated world, --bodies=<n> --ticks=<n>
+int collisionBodies(const std::vector<std::string>& args);
+
+int run(const std::string& name, const std::vector<std::string>& args);
+} // namespace benchmark
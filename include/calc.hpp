@@ -1,102 +1,573 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <initializer_list>
 #include <math.h>
+#include <type_traits>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CALC_SSE
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CALC_NEON
+#endif
+
+// Header only so every kernel can inline, constant evaluation takes the scalar lanes and runtime the SSE or NEON ones
 namespace calc {
-inline float degrees(float val) {
+inline constexpr float degrees(float val) {
   return val * M_PI / 180.0f;
 }
 
+// std::sqrt is not constexpr yet, Newton's method from above converges to the same float
+constexpr float sqrt(float value) {
+  if consteval {
+    if(value <= 0.0f) {
+      return 0.0f;
+    }
+
+    double x = value > 1.0f ? value : 1.0;
+    for(int i = 0; i < 128; ++i) {
+      double next = 0.5 * (x + value / x);
+      if(next >= x) {
+        break;
+      }
+      x = next;
+    }
+
+    return static_cast<float>(x);
+  } else {
+    return std::sqrt(value);
+  }
+}
+
+namespace lanes {
+// Four floats with just the operations the Mat4 kernels need
+struct Scalar {
+  std::array<float, 4> v;
+
+  static constexpr Scalar set(float a, float b, float c, float d) {
+    return {{a, b, c, d}};
+  }
+
+  static constexpr Scalar splat(float a) {
+    return {{a, a, a, a}};
+  }
+
+  static constexpr Scalar load(const float* p) {
+    return {{p[0], p[1], p[2], p[3]}};
+  }
+
+  constexpr void store(float* p) const {
+    std::copy(v.begin(), v.end(), p);
+  }
+
+  static constexpr void transpose(Scalar& a, Scalar& b, Scalar& c, Scalar& d) {
+    Scalar ta = a, tb = b, tc = c, td = d;
+    a = {{ta.v[0], tb.v[0], tc.v[0], td.v[0]}};
+    b = {{ta.v[1], tb.v[1], tc.v[1], td.v[1]}};
+    c = {{ta.v[2], tb.v[2], tc.v[2], td.v[2]}};
+    d = {{ta.v[3], tb.v[3], tc.v[3], td.v[3]}};
+  }
+
+  constexpr Scalar operator+(const Scalar& o) const {
+    return {{v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3]}};
+  }
+
+  constexpr Scalar operator-(const Scalar& o) const {
+    return {{v[0] - o.v[0], v[1] - o.v[1], v[2] - o.v[2], v[3] - o.v[3]}};
+  }
+
+  constexpr Scalar operator*(const Scalar& o) const {
+    return {{v[0] * o.v[0], v[1] * o.v[1], v[2] * o.v[2], v[3] * o.v[3]}};
+  }
+
+  constexpr Scalar operator/(const Scalar& o) const {
+    return {{v[0] / o.v[0], v[1] / o.v[1], v[2] / o.v[2], v[3] / o.v[3]}};
+  }
+
+  // Length of x, y and z in every lane
+  static constexpr Scalar length3(const Scalar& a) {
+    return splat(calc::sqrt(a.v[0] * a.v[0] + a.v[1] * a.v[1] + a.v[2] * a.v[2]));
+  }
+
+  // Lanes not above the threshold become the replacement
+  static constexpr Scalar above(const Scalar& a, float threshold, float replacement) {
+    Scalar result = a;
+    for(float& value : result.v) {
+      value = value > threshold ? value : replacement;
+    }
+    return result;
+  }
+};
+
+#if defined(CALC_SSE)
+struct Simd {
+  __m128 v;
+
+  static Simd set(float a, float b, float c, float d) { return {_mm_setr_ps(a, b, c, d)}; }
+  static Simd splat(float a) { return {_mm_set1_ps(a)}; }
+  // Vec4 is only float aligned so it can sit in the vertex format without padding
+  static Simd load(const float* p) { return {_mm_loadu_ps(p)}; }
+  void store(float* p) const { _mm_storeu_ps(p, v); }
+
+  static void transpose(Simd& a, Simd& b, Simd& c, Simd& d) {
+    _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+  }
+
+  Simd operator+(const Simd& o) const { return {_mm_add_ps(v, o.v)}; }
+  Simd operator-(const Simd& o) const { return {_mm_sub_ps(v, o.v)}; }
+  Simd operator*(const Simd& o) const { return {_mm_mul_ps(v, o.v)}; }
+  Simd operator/(const Simd& o) const { return {_mm_div_ps(v, o.v)}; }
+
+  static Simd length3(const Simd& a) {
+    __m128 squares = _mm_mul_ps(a.v, a.v);
+    __m128 sum = _mm_add_ss(_mm_add_ss(squares, _mm_shuffle_ps(squares, squares, 1)), _mm_shuffle_ps(squares, squares, 2));
+    __m128 length = _mm_sqrt_ss(sum);
+    return {_mm_shuffle_ps(length, length, 0)};
+  }
+
+  static Simd above(const Simd& a, float threshold, float replacement) {
+    __m128 mask = _mm_cmpgt_ps(a.v, _mm_set1_ps(threshold));
+    return {_mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, _mm_set1_ps(replacement)))};
+  }
+};
+#elif defined(CALC_NEON)
+struct Simd {
+  float32x4_t v;
+
+  static Simd set(float a, float b, float c, float d) {
+    float values[4] = {a, b, c, d};
+    return {vld1q_f32(values)};
+  }
+
+  static Simd splat(float a) { return {vdupq_n_f32(a)}; }
+  static Simd load(const float* p) { return {vld1q_f32(p)}; }
+  void store(float* p) const { vst1q_f32(p, v); }
+
+  static void transpose(Simd& a, Simd& b, Simd& c, Simd& d) {
+    float32x4x2_t ab = vtrnq_f32(a.v, b.v);
+    float32x4x2_t cd = vtrnq_f32(c.v, d.v);
+    a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+  }
+
+  // Separate multiply and add like SSE, so both give the scalar results bit for bit
+  Simd operator+(const Simd& o) const { return {vaddq_f32(v, o.v)}; }
+  Simd operator-(const Simd& o) const { return {vsubq_f32(v, o.v)}; }
+  Simd operator*(const Simd& o) const { return {vmulq_f32(v, o.v)}; }
+  Simd operator/(const Simd& o) const { return {vdivq_f32(v, o.v)}; }
+
+  static Simd length3(const Simd& a) {
+    float32x4_t squares = vmulq_f32(a.v, a.v);
+    float sum = vgetq_lane_f32(squares, 0) + vgetq_lane_f32(squares, 1) + vgetq_lane_f32(squares, 2);
+    return {vdupq_n_f32(std::sqrt(sum))};
+  }
+
+  static Simd above(const Simd& a, float threshold, float replacement) {
+    return {vbslq_f32(vcgtq_f32(a.v, vdupq_n_f32(threshold)), a.v, vdupq_n_f32(replacement))};
+  }
+};
+#else
+using Simd = Scalar;
+#endif
+} // namespace lanes
+
 class Vec2 {
 public:
   float x, y;
 
-  Vec2();
+  constexpr Vec2() : x(0.0f), y(0.0f) {}
 
-  Vec2(const float& x1, const float& y1, const float& x2, const float& y2);
+  constexpr Vec2(const float& x1, const float& y1, const float& x2, const float& y2) : x(x2 - x1), y(y2 - y1) {}
 
-  Vec2(float theta);
+  Vec2(float theta) {
+    theta *= 2.0 * M_PI;
+    this->x = std::cos(theta);
+    this->y = std::sin(theta);
+  }
 
-  Vec2(float x, float y);
+  constexpr Vec2(float x, float y) : x(x), y(y) {}
 
-  float operator*(const Vec2 &v) const;
+  constexpr float operator*(const Vec2 &v) const {
+    return this->x * v.x + this->y * v.y;
+  }
 };
 
 class Vec4 {
 public:
   float x, y, z, w;
 
-  Vec4(float x, float y, float z, float w);
-
-  Vec4(std::array<float, 4> values);
-
-  Vec4();
-
-  Vec4(float value);
-
-  float magnitude() const;
-
-  Vec4 operator+(const Vec4 &v) const;
-
-  Vec4 operator-(const Vec4 &v) const;
-
-  template <typename T> Vec4 operator*(const T &value) const;
-  template <typename T> Vec4 operator/(const T &value) const;
-
-  static float dotProduct(const Vec4 &v1, const Vec4 &v2);
-  static Vec4 normalize(const Vec4& v);
-  static Vec4 crossProduct(const Vec4 &v1, const Vec4 &v2);
-
-  bool operator==(const Vec4 &v) const;
-
-  float &operator[](const int index);
-
-  float operator[](const int index) const;
+  constexpr Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+  constexpr Vec4(std::array<float, 4> values) : x(values[0]), y(values[1]), z(values[2]), w(values[3]) {}
+
+  constexpr Vec4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+
+  constexpr Vec4(float value) : x(value), y(value), z(value), w(value) {}
+
+  constexpr float magnitude() const {
+    return calc::sqrt(this->x * this->x + this->y * this->y + this->z * this->z + this->w * this->w);
+  }
+
+  constexpr Vec4 operator+(const Vec4 &v) const {
+    return {this->x + v.x, this->y + v.y, this->z + v.z, this->w + v.w};
+  }
+
+  constexpr Vec4 operator-(const Vec4 &v) const {
+    return {this->x - v.x, this->y - v.y, this->z - v.z, this->w - v.w};
+  }
+
+  template <typename T> requires std::is_arithmetic_v<T> constexpr Vec4 operator*(const T &value) const {
+    return {this->x * value, this->y * value, this->z * value, this->w * value};
+  }
+
+  template <typename T> requires std::is_arithmetic_v<T> constexpr Vec4 operator/(const T &value) const {
+    return {this->x / value, this->y / value, this->z / value, this->w / value};
+  }
+
+  static constexpr float dotProduct(const Vec4 &v1, const Vec4 &v2) {
+    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+  }
+
+  static constexpr Vec4 normalize(const Vec4& v) {
+    float mag = calc::sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
+
+    if(mag < 1e-6f) {
+      return {0, 0, 0, 0};
+    } else {
+      return {v.x / mag, v.y / mag, v.z / mag, 0.0f};
+    }
+  }
+
+  static constexpr Vec4 crossProduct(const Vec4 &v1, const Vec4 &v2) {
+    return {
+      v1.y * v2.z - v1.z * v2.y,
+      v1.z * v2.x - v1.x * v2.z,
+      v1.x * v2.y - v1.y * v2.x,
+      0.0f
+    };
+  }
+
+  constexpr bool operator==(const Vec4 &v) const {
+    return this->x == v.x && this->y == v.y && this->z == v.z && this->w == v.w;
+  }
+
+  constexpr float &operator[](const int index) {
+    switch (index) {
+    case 0:
+      return this->x;
+    case 1:
+      return this->y;
+    case 2:
+      return this->z;
+    default:
+      return this->w;
+    }
+  }
+
+  constexpr float operator[](const int index) const {
+    switch (index) {
+    case 0:
+      return this->x;
+    case 1:
+      return this->y;
+    case 2:
+      return this->z;
+    default:
+      return this->w;
+    }
+  }
 };
 
-class Mat4 {
+// Column major, (row, col) is array[col * 4 + row]
+class alignas(16) Mat4 {
 public:
   std::array<float, 16> array;
 
-  Mat4();
+  constexpr Mat4() : Mat4(1.0f) {}
 
-  Mat4(float value);
-
-  Mat4(const std::array<float, 16> &array);
-
-  Mat4(std::initializer_list<float> values);
-
-  float &operator[](int index);
-
-  const float &operator[](int index) const;
-
-  float operator()(int row, int col) const;
-
-  float &operator()(int row, int col);
-
-  Mat4 operator+(const Mat4 &matrix) const;
-
-  Mat4 operator-(const Mat4 &matrix) const;
-
-  template <typename T> Mat4 operator*(const T &value) const;
-
-  Mat4 operator*(const Mat4 &matrix) const;
-
-  Vec4 operator*(const Vec4 &vector) const;
-
-  Mat4 transpose() const;
-
-  static Mat4 MIdentity();
-
-  static Mat4 MRotationX(float theta);
-
-  static Mat4 MRotationY(float theta);
-
-  static Mat4 MRotationZ(float theta);
-
-  static Mat4 perspective(float fov, float aspect, float near, float far);
+  constexpr Mat4(float value) : array{} {
+    this->array[0] = value;
+    this->array[5] = value;
+    this->array[10] = value;
+    this->array[15] = value;
+  }
+
+  constexpr Mat4(const std::array<float, 16> &array) : array(array) {}
+
+  constexpr Mat4(std::initializer_list<float> values) : array{} {
+    if (values.size() == 16) {
+      std::copy(values.begin(), values.end(), this->array.begin());
+    }
+  }
+
+  constexpr float &operator[](int index) { return this->array[index]; }
+
+  constexpr const float &operator[](int index) const { return this->array[index]; }
+
+  constexpr float operator()(int row, int col) const {
+    return this->array[col * 4 + row];
+  }
+
+  constexpr float &operator()(int row, int col) {
+    return this->array[col * 4 + row];
+  }
+
+  constexpr bool operator==(const Mat4 &matrix) const = default;
+
+  constexpr Mat4 operator+(const Mat4 &matrix) const {
+    Mat4 result(0.0f);
+
+    for (int i = 0; i < 16; ++i) {
+      result[i] = this->array[i] + matrix[i];
+    }
+
+    return result;
+  }
+
+  constexpr Mat4 operator-(const Mat4 &matrix) const {
+    Mat4 result(0.0f);
+
+    for (int i = 0; i < 16; ++i) {
+      result[i] = this->array[i] - matrix[i];
+    }
+
+    return result;
+  }
+
+  template <typename T> requires std::is_arithmetic_v<T> constexpr Mat4 operator*(const T &value) const {
+    Mat4 result(0.0f);
+
+    for (int i = 0; i < 16; ++i) {
+      result[i] = this->array[i] * value;
+    }
+
+    return result;
+  }
+
+  // Every result column is the columns of a weighted by one column of b
+  template <typename L> static constexpr Mat4 multiply(const Mat4 &a, const Mat4 &b) {
+    L c0 = L::load(&a.array[0]), c1 = L::load(&a.array[4]), c2 = L::load(&a.array[8]), c3 = L::load(&a.array[12]);
+    Mat4 result(0.0f);
+
+    for (int j = 0; j < 4; ++j) {
+      const float* column = &b.array[j * 4];
+      L r = c0 * L::splat(column[0]) + c1 * L::splat(column[1]) + c2 * L::splat(column[2]) + c3 * L::splat(column[3]);
+      r.store(&result.array[j * 4]);
+    }
+
+    return result;
+  }
+
+  template <typename L> static constexpr Vec4 transform(const Mat4 &a, const Vec4 &v) {
+    L r = L::load(&a.array[0]) * L::splat(v.x) + L::load(&a.array[4]) * L::splat(v.y) + L::load(&a.array[8]) * L::splat(v.z) + L::load(&a.array[12]) * L::splat(v.w);
+
+    std::array<float, 4> values;
+    r.store(values.data());
+    return Vec4(values);
+  }
+
+  // Cofactors four at a time, the determinant comes from the first column of the adjugate
+  template <typename L> static constexpr Mat4 inverse(const Mat4 &m) {
+    auto at = [&](int col, int row) { return m.array[col * 4 + row]; };
+
+    float coef00 = at(2, 2) * at(3, 3) - at(3, 2) * at(2, 3);
+    float coef02 = at(1, 2) * at(3, 3) - at(3, 2) * at(1, 3);
+    float coef03 = at(1, 2) * at(2, 3) - at(2, 2) * at(1, 3);
+    float coef04 = at(2, 1) * at(3, 3) - at(3, 1) * at(2, 3);
+    float coef06 = at(1, 1) * at(3, 3) - at(3, 1) * at(1, 3);
+    float coef07 = at(1, 1) * at(2, 3) - at(2, 1) * at(1, 3);
+    float coef08 = at(2, 1) * at(3, 2) - at(3, 1) * at(2, 2);
+    float coef10 = at(1, 1) * at(3, 2) - at(3, 1) * at(1, 2);
+    float coef11 = at(1, 1) * at(2, 2) - at(2, 1) * at(1, 2);
+    float coef12 = at(2, 0) * at(3, 3) - at(3, 0) * at(2, 3);
+    float coef14 = at(1, 0) * at(3, 3) - at(3, 0) * at(1, 3);
+    float coef15 = at(1, 0) * at(2, 3) - at(2, 0) * at(1, 3);
+    float coef16 = at(2, 0) * at(3, 2) - at(3, 0) * at(2, 2);
+    float coef18 = at(1, 0) * at(3, 2) - at(3, 0) * at(1, 2);
+    float coef19 = at(1, 0) * at(2, 2) - at(2, 0) * at(1, 2);
+    float coef20 = at(2, 0) * at(3, 1) - at(3, 0) * at(2, 1);
+    float coef22 = at(1, 0) * at(3, 1) - at(3, 0) * at(1, 1);
+    float coef23 = at(1, 0) * at(2, 1) - at(2, 0) * at(1, 1);
+
+    L fac0 = L::set(coef00, coef00, coef02, coef03);
+    L fac1 = L::set(coef04, coef04, coef06, coef07);
+    L fac2 = L::set(coef08, coef08, coef10, coef11);
+    L fac3 = L::set(coef12, coef12, coef14, coef15);
+    L fac4 = L::set(coef16, coef16, coef18, coef19);
+    L fac5 = L::set(coef20, coef20, coef22, coef23);
+
+    L vec0 = L::set(at(1, 0), at(0, 0), at(0, 0), at(0, 0));
+    L vec1 = L::set(at(1, 1), at(0, 1), at(0, 1), at(0, 1));
+    L vec2 = L::set(at(1, 2), at(0, 2), at(0, 2), at(0, 2));
+    L vec3 = L::set(at(1, 3), at(0, 3), at(0, 3), at(0, 3));
+
+    L signA = L::set(1.0f, -1.0f, 1.0f, -1.0f);
+    L signB = L::set(-1.0f, 1.0f, -1.0f, 1.0f);
+
+    L inv0 = (vec1 * fac0 - vec2 * fac1 + vec3 * fac2) * signA;
+    L inv1 = (vec0 * fac0 - vec2 * fac3 + vec3 * fac4) * signB;
+    L inv2 = (vec0 * fac1 - vec1 * fac3 + vec3 * fac5) * signA;
+    L inv3 = (vec0 * fac2 - vec1 * fac4 + vec2 * fac5) * signB;
+
+    Mat4 result(0.0f);
+    inv0.store(&result.array[0]);
+    inv1.store(&result.array[4]);
+    inv2.store(&result.array[8]);
+    inv3.store(&result.array[12]);
+
+    float determinant = (at(0, 0) * result.array[0] + at(0, 1) * result.array[4]) + (at(0, 2) * result.array[8] + at(0, 3) * result.array[12]);
+    L scale = L::splat(1.0f / determinant);
+
+    for (int j = 0; j < 4; ++j) {
+      (L::load(&result.array[j * 4]) * scale).store(&result.array[j * 4]);
+    }
+
+    return result;
+  }
+
+  // Rows are the transposed columns, each plane is one add or subtract of them
+  template <typename L> static constexpr std::array<Vec4, 6> frustumPlanes(const Mat4 &m) {
+    L r0 = L::load(&m.array[0]), r1 = L::load(&m.array[4]), r2 = L::load(&m.array[8]), r3 = L::load(&m.array[12]);
+    L::transpose(r0, r1, r2, r3);
+
+    // A length too small to normalize divides by one instead
+    auto normalize = [](const L& plane) {
+      std::array<float, 4> values;
+      (plane / L::above(L::length3(plane), 1e-6f, 1.0f)).store(values.data());
+      return Vec4(values);
+    };
+
+    return {normalize(r3 + r0), normalize(r3 - r0), normalize(r3 + r1), normalize(r3 - r1), normalize(r2), normalize(r3 - r2)};
+  }
+
+  constexpr Mat4 operator*(const Mat4 &matrix) const {
+    if consteval {
+      return multiply<lanes::Scalar>(*this, matrix);
+    } else {
+      return multiply<lanes::Simd>(*this, matrix);
+    }
+  }
+
+  constexpr Vec4 operator*(const Vec4 &vector) const {
+    if consteval {
+      return transform<lanes::Scalar>(*this, vector);
+    } else {
+      return transform<lanes::Simd>(*this, vector);
+    }
+  }
+
+  // Singular matrices give infinities, callers invert only view and projection matrices
+  constexpr Mat4 inverse() const {
+    if consteval {
+      return inverse<lanes::Scalar>(*this);
+    } else {
+      return inverse<lanes::Simd>(*this);
+    }
+  }
+
+  constexpr Mat4 transpose() const {
+    Mat4 result(0.0f);
+
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        result[i * 4 + j] = this->array[j * 4 + i];
+      }
+    }
+
+    return result;
+  }
+
+  static constexpr Mat4 MIdentity() { return Mat4(1.0f); }
+
+  static Mat4 MRotationX(float theta) {
+    Mat4 matrix(1.0f);
+
+    matrix[5] = std::cos(theta);
+    matrix[6] = -std::sin(theta);
+    matrix[9] = std::sin(theta);
+    matrix[10] = std::cos(theta);
+
+    return matrix;
+  }
+
+  static Mat4 MRotationY(float theta) {
+    Mat4 matrix(1.0f);
+
+    matrix[0] = std::cos(theta);
+    matrix[2] = std::sin(theta);
+    matrix[8] = -std::sin(theta);
+    matrix[10] = std::cos(theta);
+
+    return matrix;
+  }
+
+  static Mat4 MRotationZ(float theta) {
+    Mat4 matrix(1.0f);
+
+    matrix[0] = std::cos(theta);
+    matrix[1] = -std::sin(theta);
+    matrix[4] = std::sin(theta);
+    matrix[5] = std::cos(theta);
+
+    return matrix;
+  }
+
+  static Mat4 perspective(float fov, float aspect, float near, float far) {
+    float tanHalfFov = std::tan(fov / 2.0f);
+
+    Mat4 result(0.0f);
+
+    result(0,0) = 1.0f / (aspect * tanHalfFov);
+    result(1,1) = -1.0f / tanHalfFov;
+    result(2,2) = far / (near - far);
+    result(2,3) = (far * near) / (near - far);
+    result(3,2) = -1.0f;
+
+    return result;
+  }
+
+  // Normalized left, right, bottom, top, near, far planes of a clip matrix (Vulkan depth 0..1)
+  constexpr std::array<Vec4, 6> frustumPlanes() const {
+    if consteval {
+      return frustumPlanes<lanes::Scalar>(*this);
+    } else {
+      return frustumPlanes<lanes::Simd>(*this);
+    }
+  }
 };
+
+// Vertex packs Vec4 and Vec2 back to back, the uniform and storage buffers rely on these sizes
+static_assert(sizeof(Vec2) == 8 && sizeof(Vec4) == 16);
+static_assert(sizeof(Mat4) == 64 && alignof(Mat4) == 16);
+
+// Small integers keep every product exact, so the kernels are checked for equality
+namespace checks {
+constexpr Mat4 a = {1, 2, 0, 1, 0, 1, 3, 0, 2, 0, 1, 4, 1, 1, 0, 1};
+constexpr Mat4 b = {2, 0, 1, 0, 1, 3, 0, 1, 0, 1, 2, 1, 3, 0, 0, 1};
+
+static_assert(Mat4() * a == a && a * Mat4() == a);
+static_assert(a * b == Mat4{4, 4, 1, 6, 2, 6, 9, 2, 5, 2, 5, 9, 4, 7, 0, 4});
+static_assert(a * Vec4(1, 2, 3, 4) == Vec4(11, 8, 9, 17));
+static_assert(a.transpose().transpose() == a && a.transpose()(0, 1) == a(1, 0));
+static_assert((a * 2) == a + a && (a - a) == Mat4(0.0f));
+
+// Determinant one, so the inverse has integer entries as well
+constexpr Mat4 unimodular = {1, 0, 0, 0, 2, 1, 0, 0, 3, 4, 1, 0, 5, 6, 7, 1};
+static_assert(unimodular * unimodular.inverse() == Mat4() && unimodular.inverse() * unimodular == Mat4());
+static_assert(Mat4(2.0f).inverse() == Mat4(0.5f));
+
+constexpr std::array<Vec4, 6> identityPlanes = Mat4().frustumPlanes();
+static_assert(identityPlanes[0] == Vec4(1, 0, 0, 1) && identityPlanes[1] == Vec4(-1, 0, 0, 1));
+static_assert(identityPlanes[2] == Vec4(0, 1, 0, 1) && identityPlanes[3] == Vec4(0, -1, 0, 1));
+static_assert(identityPlanes[4] == Vec4(0, 0, 1, 0) && identityPlanes[5] == Vec4(0, 0, -1, 1));
+
+static_assert(calc::sqrt(16.0f) == 4.0f && calc::sqrt(2.0f) * calc::sqrt(2.0f) - 2.0f < 1e-6f);
+static_assert(Vec4::normalize(Vec4(3, 0, 4, 9)) == Vec4(0.6f, 0.0f, 0.8f, 0.0f));
+} // namespace checks
 } // namespace calc
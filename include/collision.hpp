@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+class Terrain;
+
+namespace collision {
+// Physics always advances by whole ticks, frames only decide how many
+constexpr float tick = 1.0f / 60.0f;
+constexpr float gravity = 32.0f;
+constexpr float terminalVelocity = 60.0f;
+constexpr float jumpSpeed = 9.0f;
+// Ledges up to this high are walked onto without jumping
+constexpr float stepHeight = 1.0f;
+
+// Upright box standing on its bottom face
+struct Body {
+  double x = 0.0, y = 0.0, z = 0.0;
+  float halfWidth = 0.3f;
+  float height = 1.8f;
+  float vx = 0.0f, vy = 0.0f, vz = 0.0f;
+  bool onGround = false;
+};
+
+struct Box {
+  double minX, minY, minZ;
+  double maxX, maxY, maxZ;
+};
+
+Box boxOf(const Body& body);
+// Past the sides of the world and below its bottom are solid, above its top is air
+bool solid(const Terrain& terrain, int x, int y, int z);
+// How far the box gets along axis 0, 1 or 2 (x, y, z) before a face touches a solid block, only blocks in the swept slab are read
+double sweep(const Terrain& terrain, const Box& box, int axis, double distance);
+// Gravity and velocity for dt, one axis at a time so a blocked axis does not stop the others
+void step(const Terrain& terrain, Body& body, float dt);
+// Onto the highest ground below the top of the world, the bottom of the world when the column is empty
+void drop(const Terrain& terrain, Body& body);
+} // namespace collision
@@ -2,11 +2,47 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace config {
 const std::string applicationName = "MineCloneCraft";
 const int majoranta = 0, minoranta = 0, patch = 1;
 const uint32_t chunks = 1;
+const uint32_t arenaVertexCapacity = 1 << 20;
+const uint32_t arenaIndexCapacity = 3 << 19;
+const uint32_t maxChunkDraws = 4096;
+const uint32_t chunksPerGroup = 64;
+const uint32_t maxRecordThreads = 4;
+// Nearest chunks are drawn first, the pre-pass lays down depth before any shading
+const bool sortChunks = true;
+const bool depthPrepass = false;
+const float nearPlane = 0.1f, farPlane = 100.0f;
+// Render scale and MSAA follow the GPU frame time, a budget of 0 keeps them fixed
+const double gpuFrameBudgetMs = 14.0;
+const uint32_t maxMsaaSamples = 8;
+const bool sampleShading = false;
+const float minRenderScale = 0.5f;
+const float renderScaleStep = 0.05f;
+const float renderScaleMaxDrop = 0.25f;
+const float renderScaleMaxRise = 0.1f;
+const double renderScaleOverBudget = 1.05;
+const double renderScaleUnderBudget = 0.8;
+const double renderScaleSmoothing = 0.1;
+const uint32_t renderScaleSettleFrames = 30;
+// Settle windows in a row under budget at full scale before a lowered MSAA ceiling is raised a step again
+const uint32_t renderScaleCeilingRecovery = 20;
+const std::string pipelineCachePath = "pipeline.cache";
+const std::string tracePath = "trace.json";
+// Assets are named relative to assetRoot, they are looked up in the pack first and read from there when it lacks them
+const std::string assetRoot = "../";
+const std::string assetPackName = "assets.pack";
+// Layers of the block texture array, smaller images are scaled up to the largest
+const std::vector<std::string> textureLayers = {"textures/tex.png", "textures/tri.png", "textures/blu.png"};
+// Uploaded at startup straight from the mapped file
+const std::string modelPath = "models/cube.glb";
+const double stutterFactor = 2.0;
+const uint64_t stutterWarmupFrames = 60;
+const size_t maxStutters = 1000;
 
 inline std::string fullName() {
   return applicationName + '-' + std::to_string(majoranta) + '.' + std::to_string(minoranta) + '.' + std::to_string(patch);
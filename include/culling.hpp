@@ -0,0 +1,39 @@
+#pragma once
+
+#include "calc.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class Terrain;
+
+namespace culling {
+// Chunk boxes stored as separate arrays so four boxes fit in one register per axis
+class ChunkBounds {
+public:
+  std::vector<float> minX, minY, minZ;
+  std::vector<float> maxX, maxY, maxZ;
+
+  void clear();
+  void push(float x0, float y0, float z0, float x1, float y1, float z1);
+  size_t size() const;
+};
+
+// Writes the indices of boxes that are not fully outside any plane, returns their count, batch::boxesInside does the work
+size_t cullChunks(const ChunkBounds& bounds, const std::array<calc::Vec4, 6>& planes, std::vector<uint32_t>& visible);
+
+size_t cullChunksScalar(const ChunkBounds& bounds, const std::array<calc::Vec4, 6>& planes, std::vector<uint32_t>& visible);
+
+// Nearest first by the distance to the closest point of each box, two byte passes of a radix sort on 16 bit keys
+class DistanceSorter {
+public:
+  std::vector<uint64_t> items;
+  std::vector<uint64_t> scratch;
+
+  void sort(const ChunkBounds& bounds, float x, float y, float z, std::vector<uint32_t>& chunks);
+};
+
+// Chunks a backend culling on the CPU draws: inside the frustum, reachable through the cave graph, uploaded and within
+// the draw slots, nearest to x, y, z first unless sorter is null. Returns their count
+size_t drawList(const Terrain& terrain, const std::array<calc::Vec4, 6>& planes, const std::vector<uint8_t>& reachable, float x, float y, float z, DistanceSorter* sorter, std::vector<uint32_t>& visible);
+} // namespace culling
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "meshArena.hpp"
+#include <cstdint>
+#include <deque>
+#include <vulkan/vulkan.h>
+
+enum class DeletionKind {
+  Buffer,
+  Memory,
+  DescriptorSet,
+  Range,
+};
+
+struct PendingDeletion {
+  uint64_t frame;
+  DeletionKind kind;
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDescriptorPool pool = VK_NULL_HANDLE;
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  RangeAllocator* allocator = nullptr;
+  ArenaRange range;
+};
+
+// Resources are tagged with the last frame that may still use them and freed once that frame's fence has retired
+class DeletionQueue {
+public:
+  std::deque<PendingDeletion> pending;
+
+  void buffer(uint64_t frame, VkBuffer buffer);
+  void memory(uint64_t frame, VkDeviceMemory memory);
+  // The pool has to be created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+  void descriptorSet(uint64_t frame, VkDescriptorPool pool, VkDescriptorSet set);
+  // Arena ranges go back to their allocator late so a new upload can not overwrite what a frame still draws
+  void range(uint64_t frame, RangeAllocator& allocator, const ArenaRange& range);
+
+  size_t retire(VkDevice device, uint64_t completedFrame);
+  // Only after the device is idle
+  size_t flush(VkDevice device);
+
+private:
+  void push(PendingDeletion deletion);
+  void destroy(VkDevice device, const PendingDeletion& deletion);
+};
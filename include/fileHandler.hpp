@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 namespace fileHandler {
@@ -12,25 +16,134 @@ enum chunkType : uint32_t {
   BIN = 0x004E4942,
 };
 
+enum componentType : uint32_t {
+  BYTE = 5120,
+  UNSIGNED_BYTE = 5121,
+  SHORT = 5122,
+  UNSIGNED_SHORT = 5123,
+  UNSIGNED_INT = 5125,
+  FLOAT = 5126,
+};
+
+// Read only view of a whole file, the OS pages it in on first touch
+class MappedFile {
+public:
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+
+  MappedFile() = default;
+  MappedFile(const std::string &fileName);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  bool isOpen() const;
+  std::span<const unsigned char> bytes() const;
+};
+
+// Bump allocator, everything it handed out is freed together with it
+class JSONArena {
+public:
+  static constexpr size_t blockSize = 64 * 1024;
+  std::vector<std::unique_ptr<std::byte[]>> blocks;
+  size_t used = 0;
+  size_t capacity = 0;
+
+  template <typename T> T *allocate(size_t count) {
+    size_t bytes = sizeof(T) * count;
+    used = (used + alignof(T) - 1) & ~(alignof(T) - 1);
+
+    if (blocks.empty() || used + bytes > capacity) {
+      capacity = std::max(blockSize, bytes);
+      blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(capacity));
+      used = 0;
+    }
+
+    T *result = reinterpret_cast<T *>(blocks.back().get() + used);
+    used += bytes;
+    return result;
+  }
+};
+
+enum class JSONType : uint8_t {
+  Object,
+  Array,
+  String,
+  Number,
+  True,
+  False,
+  Null,
+};
+
+// Containers are followed on the tape by their children, object children alternate key and value.
+// Sixteen bytes so a lookup walking siblings touches as few cache lines as it can
+struct JSONNode {
+  JSONType type;
+  // Tape index just past this value and everything under it
+  uint32_t next;
+  // Scalars: where their text starts in the source, long arrays: their child index plus one
+  uint32_t offset;
+  // Scalars: text length, containers: element count
+  uint32_t size;
+};
+
+// Tape over a source that has to outlive it, values are decoded only when asked for.
+// Paths are dotted keys and array indices like "meshes.0.primitives.0.indices"
+// Lookups never write, so any number of threads can read one document
 class ParseJSON {
 public:
-  std::unordered_map<std::string, std::string> um;
+  JSONArena arena;
+  std::string_view source;
+  JSONNode *tape = nullptr;
+  uint32_t tapeSize = 0;
+  bool valid = false;
 
-  int trimKey(const std::string &s);
+  ParseJSON() = default;
+  ParseJSON(std::span<const unsigned char> v);
+  ParseJSON(ParseJSON &&other) noexcept = default;
+  ParseJSON &operator=(ParseJSON &&other) noexcept = default;
 
-  ParseJSON(const std::vector<unsigned char> &v);
+  const JSONNode *find(std::string_view path) const;
+  // Strings without their quotes and with their escapes still in
+  std::string_view view(const JSONNode *node) const;
+  bool has(const std::string &s) const;
+  // Strings unescaped, other scalars as written, objects and arrays their element count, "{}" when missing
+  std::string get(const std::string &s) const;
+  size_t getUnsigned(const std::string &s, size_t fallback) const;
 
-  std::string get(const std::string &s);
+  // Offsets of every unescaped quote and every {}[]:, outside a string, returns how many were written
+  static size_t structurals(std::span<const unsigned char> text, uint32_t *out);
+  static std::string unescape(std::string_view text);
+  static std::string formatJSON(std::span<const unsigned char> v);
 
-  static std::string formatJSON(const std::vector<unsigned char> &v);
+private:
+  std::span<const unsigned char> text;
+  const uint32_t *indices = nullptr;
+  size_t indexCount = 0;
+  size_t cursor = 0;
+  size_t consumed = 0;
+  // Child offsets of every array over 16 elements
+  std::vector<const uint32_t *> arrayIndexes;
+
+  bool parseValue(uint32_t depth);
+  bool parseContainer(JSONType type, uint32_t depth);
+  bool parseString();
+  bool parseLiteral();
+  size_t skipWhitespace(size_t from) const;
+  const JSONNode *child(const JSONNode *node, std::string_view segment) const;
+  bool fail(const char *what, size_t at);
+  void indexLongArrays();
 };
 
+// Points into the mapped file, valid as long as the model that owns the mapping
 class glTFchunk {
 public:
   uint32_t type;
-  std::vector<unsigned char> data;
+  std::span<const unsigned char> data;
 
-  glTFchunk(uint32_t type, std::vector<unsigned char> &&chunkData);
+  glTFchunk(uint32_t type, std::span<const unsigned char> chunkData);
 
   static inline std::string typeToString(const uint32_t &type) {
     switch (type) {
@@ -44,17 +157,54 @@ public:
   }
 };
 
+// Where an accessor's elements sit in the BIN chunk
+struct AccessorLayout {
+  size_t offset = 0;
+  size_t count = 0;
+  size_t elementSize = 0;
+  uint32_t componentType = 0;
+};
+
 class glTFmodel {
 public:
-  uint32_t magic;
-  uint32_t version;
-  uint32_t length;
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t length = 0;
+  // Closed when the model views bytes owned by someone else
+  MappedFile file;
   std::vector<glTFchunk> chunks;
+  ParseJSON json;
 
   glTFmodel(const std::string &fileName);
+  // The bytes have to outlive the model
+  glTFmodel(std::span<const unsigned char> bytes);
 
+  bool isValid() const;
   void info();
 
-  std::vector<std::tuple<float, float, float>> getVertices();
+  std::span<const unsigned char> binary() const;
+  bool accessorLayout(size_t index, AccessorLayout &layout) const;
+
+  // Empty when the accessor is not tightly packed elements of exactly T
+  template <typename T> std::span<const T> accessor(size_t index) const {
+    AccessorLayout layout;
+    if (!accessorLayout(index, layout) || layout.elementSize != sizeof(T)) {
+      return {};
+    }
+
+    const unsigned char *first = binary().data() + layout.offset;
+    if (reinterpret_cast<uintptr_t>(first) % alignof(T) != 0) {
+      return {};
+    }
+
+    return {reinterpret_cast<const T *>(first), layout.count};
+  }
+
+  // Accessor index of a primitive's attribute or indices, -1 when it has none
+  int64_t attribute(size_t mesh, size_t primitive, const std::string &name) const;
+  int64_t indices(size_t mesh, size_t primitive) const;
+
+private:
+  void parse(std::span<const unsigned char> bytes);
 };
 } // namespace fileHandler
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace framePacing {
+// Low latency keeps one frame queued, throughput lets the CPU run up to three frames ahead of vsync
+enum class LatencyMode {
+  LowLatency,
+  Balanced,
+  Throughput
+};
+
+const char* name(LatencyMode mode);
+bool parse(const std::string& text, LatencyMode& mode);
+LatencyMode next(LatencyMode mode);
+
+uint32_t framesInFlight(LatencyMode mode);
+// Best first, FIFO is always supported so every list ends with it
+std::vector<VkPresentModeKHR> presentModes(LatencyMode mode);
+
+// Sleeps until the next frame slot, a cap of 0 disables it
+class FrameLimiter {
+public:
+  double fpsCap = 0.0;
+  Uint64 nextFrame = 0;
+
+  void wait();
+};
+
+// Time from the first input event of a frame until the frame carrying it was handed to present
+class LatencyTracker {
+public:
+  Uint64 pendingInput = 0;
+  Uint64 sum = 0;
+  Uint64 maximum = 0;
+  uint32_t samples = 0;
+
+  void input(Uint64 timestamp);
+  void presented(Uint64 timestamp);
+
+  // Average and worst since the last reset, in milliseconds
+  double averageMs() const;
+  double maximumMs() const;
+  void reset();
+};
+} // namespace framePacing
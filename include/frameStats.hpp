@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace frameStats {
+// Log buckets with 16 linear steps per power of two, any value is within 1/16 of its bucket
+class Histogram {
+public:
+  std::array<uint64_t, 1024> buckets{};
+  uint64_t count = 0;
+  uint64_t maximum = 0;
+
+  static size_t bucket(uint64_t value);
+  static uint64_t bucketValue(size_t index);
+
+  void record(uint64_t value);
+  uint64_t percentile(double p) const;
+};
+
+struct Stutter {
+  uint64_t frame;
+  double ms;
+  double medianMs;
+  std::string zone;
+  double zoneOverMs;
+};
+
+// Fed once per frame from the main loop, stutters are blamed on the profiler zone that ran furthest over its average
+class FrameReporter {
+public:
+  Histogram histogram;
+  std::vector<Stutter> stutters;
+  uint64_t frames = 0;
+  uint64_t median = 0;
+  size_t zoneCursor = 0;
+  // Spans the whole frame, so it would always be blamed
+  const char* frameZone = "frame";
+  std::unordered_map<const char*, double> zoneAverages;
+
+  void frame(uint64_t start, uint64_t end);
+  std::string report() const;
+  bool write(const std::string& path) const;
+};
+} // namespace frameStats
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "player.hpp"
+#include "renderBackend.hpp"
+#include "terrain.hpp"
+
+namespace game {
+// Movement axes from -1 to 1 and mouse motion in pixels since the last frame, from the devices or from a script
+struct Input {
+  float forward = 0.0f;
+  float right = 0.0f;
+  float up = 0.0f;
+  float dx = 0.0f;
+  float dy = 0.0f;
+};
+
+// Movement keys held right now, mouse motion comes with the events and is left to the caller
+Input keyboard();
+// One frame of the game after its input was gathered, the window loop and --bench-loop both run exactly this
+void frame(RenderBackend& renderer, Player& player, Terrain& terrain, const Input& input, float dt);
+} // namespace game
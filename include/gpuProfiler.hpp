@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Last 120 samples, enough for two seconds at 60 fps
+class RollingStat {
+public:
+  std::array<double, 120> samples{};
+  size_t count = 0;
+  size_t next = 0;
+
+  void push(double value);
+  double average() const;
+  double minimum() const;
+  double maximum() const;
+  double latest() const;
+};
+
+// Timestamps and pipeline statistics per frame slot. A slot is only read after its fence
+// has been waited on, so results are always framesInFlight frames old and never stall
+class GpuProfiler {
+public:
+  // Fixed queries at the start of every slot, chunk group pipelines follow
+  enum Query : uint32_t {
+    FrameBegin,
+    PassBegin,
+    PassEnd,
+    FrameEnd,
+    FixedQueries
+  };
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkQueryPool timestampPool = VK_NULL_HANDLE;
+  VkQueryPool statisticsPool = VK_NULL_HANDLE;
+  VkQueryPipelineStatisticFlags statisticFlags = 0;
+  float timestampPeriod = 1.0f;
+  uint32_t maxGroups = 0;
+  uint32_t maxPipelines = 0;
+  uint32_t queriesPerFrame = 0;
+  std::vector<bool> written;
+
+  RollingStat frame;
+  RollingStat renderPass;
+  std::vector<RollingStat> pipelines;
+  RollingStat vertexInvocations;
+  RollingStat fragmentInvocations;
+
+  void create(VkDevice device, const VkPhysicalDeviceProperties& properties, const VkPhysicalDeviceFeatures& features, uint32_t frames, uint32_t maxGroups, uint32_t maxPipelines);
+  void destroy();
+
+  bool hasTimestamps() const;
+  bool hasStatistics() const;
+  uint32_t pipelineQuery(uint32_t frame, uint32_t group, uint32_t pipeline) const;
+
+  // Reset has to be recorded outside of a render pass
+  void reset(VkCommandBuffer commandBuffer, uint32_t frame);
+  void timestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query);
+  void beginStatistics(VkCommandBuffer commandBuffer, uint32_t frame);
+  void endStatistics(VkCommandBuffer commandBuffer, uint32_t frame);
+  void submitted(uint32_t frame);
+  // True when a new frame time was read
+  bool collect(uint32_t frame);
+
+  std::string report() const;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct ArenaRange {
+  uint32_t offset = 0;
+  uint32_t count = 0;
+};
+
+// First-fit free list over elements of one big buffer, neighbours are merged on free
+class RangeAllocator {
+public:
+  uint32_t capacity;
+  uint32_t used;
+  std::vector<ArenaRange> freeRanges;
+
+  RangeAllocator();
+  RangeAllocator(uint32_t capacity);
+
+  bool allocate(uint32_t count, ArenaRange& range);
+  void free(const ArenaRange& range);
+};
+
+class MeshArena {
+public:
+  VkBuffer vertexBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+  VkBuffer indexBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+  RangeAllocator vertices;
+  RangeAllocator indices;
+};
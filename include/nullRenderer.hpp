@@ -0,0 +1,41 @@
+#pragma once
+
+#include "renderBackend.hpp"
+#include "culling.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Does the CPU side of a frame, culling and draw submission, and counts what a GPU would have been given
+class NullRenderer : public RenderBackend {
+public:
+  uint32_t width;
+  uint32_t height;
+  uint64_t frames = 0;
+  uint64_t uploads = 0;
+  uint64_t releases = 0;
+  uint64_t uploadedBytes = 0;
+  uint64_t draws = 0;
+  uint64_t triangles = 0;
+  uint64_t presentedAt = 0;
+  framePacing::LatencyMode latencyMode = framePacing::LatencyMode::Balanced;
+  bool depthPrepass = false;
+  std::vector<uint32_t> visibleChunks;
+  std::vector<uint8_t> reachableChunks;
+  culling::DistanceSorter chunkSorter;
+
+  NullRenderer(uint32_t width, uint32_t height);
+
+  void uploadTerrain(Terrain& terrain) override;
+  void releaseChunkMesh(Terrain& terrain, uint32_t chunk) override;
+  void drawFrame(Player* player, Terrain& terrain) override;
+  void windowResized() override;
+  void setLatencyMode(framePacing::LatencyMode mode) override;
+  framePacing::LatencyMode getLatencyMode() const override;
+  void setDepthPrepass(bool enabled) override;
+  float getRenderScale() const override;
+  uint32_t getMsaaSamples() const override;
+  double lastGpuTimeMs() const override;
+  uint64_t lastPresentNs() const override;
+  std::string gpuReport() const override;
+};
@@ -3,22 +3,40 @@
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_events.h>
 #include <math.h>
+#include "calc.hpp"
+#include "collision.hpp"
 
 class Player {
 private:
 public:
-  float x;
-  float y;
-  float z;
+  // Double so positions stay exact far from the world origin, the renderer splits them into chunk and offset
+  double x;
+  double y;
+  double z;
   float mouseX;
   float mouseY;
   uint32_t renderType = 0;
   const float FOV = 45.0f;
+  const float eyeHeight = 1.62f;
+  // Feet of the walking player, the camera follows it at eye height between the last two ticks
+  collision::Body body;
+  double previousX, previousY, previousZ;
+  float tickTime = 0.0f;
+  bool flying = false;
 
-  Player(float x, float y, float z);
+  Player(double x, double y, double z);
 
+  // Toggles only, movement and mouse motion reach the player through game::frame
   void handleEvent(const SDL_Event& event);
+  // Mouse motion in pixels and movement axes from -1 to 1, the keyboard and scripted input both end up here
+  void turn(float dx, float dy);
+  void move(float forward, float right, float up, float dt);
+  // Whole physics ticks for the time dt adds up to, jumping only works from the ground
+  void walk(const Terrain& terrain, float forward, float right, bool jump, float dt);
+  void setFlying(bool flying);
+  void placeOnGround(const Terrain& terrain);
   float getFOV();
-
-  void handleInput(const float& dt);
+  calc::Mat4 rotation() const;
+  calc::Mat4 translation() const;
+  calc::Mat4 projection(float aspect) const;
 };
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Configure with -DPROFILING=OFF to compile every zone out
+#ifdef PROFILING_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#endif
+
+namespace profiler {
+struct Event {
+  const char* name;
+  uint64_t start;
+  uint64_t end;
+};
+
+// Trace thread of the events from firstEvent up to the next track of the same buffer
+struct Track {
+  uint32_t id;
+  std::string name;
+  size_t firstEvent;
+};
+
+// Only the owning thread writes, readers see events up to the released count
+class ThreadBuffer {
+public:
+  static constexpr size_t blockSize = 4096;
+  static constexpr size_t maxBlocks = 1024;
+
+  std::array<std::atomic<Event*>, maxBlocks> blocks{};
+  std::atomic<size_t> count = 0;
+  std::atomic<size_t> dropped = 0;
+  // Every thread that wrote here has its own, the last one belongs to the current owner. Guarded by the buffer list's mutex
+  std::vector<Track> tracks;
+  // Its thread exited, the next new thread writes on after its events. Guarded by the buffer list's mutex
+  bool retired = false;
+
+  ~ThreadBuffer();
+
+  void push(const Event& event);
+  // Valid for indices below an acquired count
+  const Event& at(size_t index) const;
+};
+
+uint64_t now();
+// Threads that come and go share the buffers of the ones that exited, so there are never more than were alive at once.
+// Each thread still gets a track of its own in the trace
+ThreadBuffer& threadBuffer();
+void setThreadName(const std::string& name);
+
+// Chrome trace event format, opens in chrome://tracing and Perfetto
+bool writeChromeTrace(const std::string& path);
+
+class Zone {
+public:
+  const char* name;
+  uint64_t start;
+
+  Zone(const char* name);
+  ~Zone();
+};
+} // namespace profiler
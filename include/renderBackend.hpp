@@ -0,0 +1,28 @@
+#pragma once
+
+#include "framePacing.hpp"
+#include "player.hpp"
+#include "terrain.hpp"
+#include <cstdint>
+#include <string>
+
+// What the game loop needs from a renderer, so the loop can run on the null backend without a GPU
+class RenderBackend {
+public:
+  virtual ~RenderBackend() = default;
+
+  virtual void uploadTerrain(Terrain& terrain) = 0;
+  virtual void releaseChunkMesh(Terrain& terrain, uint32_t chunk) = 0;
+  virtual void drawFrame(Player* player, Terrain& terrain) = 0;
+  virtual void windowResized() = 0;
+  // Runtime switches of the game loop, a backend without them keeps the value and ignores it
+  virtual void setLatencyMode(framePacing::LatencyMode mode) = 0;
+  virtual framePacing::LatencyMode getLatencyMode() const = 0;
+  virtual void setDepthPrepass(bool enabled) = 0;
+  virtual float getRenderScale() const = 0;
+  virtual uint32_t getMsaaSamples() const = 0;
+  virtual double lastGpuTimeMs() const = 0;
+  // SDL_GetTicksNS right after the newest frame was handed to present, 0 before the first
+  virtual uint64_t lastPresentNs() const = 0;
+  virtual std::string gpuReport() const = 0;
+};
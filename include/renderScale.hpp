@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace renderScale {
+enum class Change {
+  None,
+  Scale,
+  Samples
+};
+
+// Sample counts are masks of VkSampleCountFlagBits, whose bits equal the counts they stand for
+uint32_t fewerSamples(uint32_t samples, uint32_t supported);
+uint32_t moreSamples(uint32_t samples, uint32_t supported, uint32_t limit);
+
+// Holds the GPU frame time under a budget, MSAA goes first when over it and comes back last
+class Controller {
+public:
+  // 0 keeps the current scale and samples
+  double budgetMs = 0.0;
+  float scale = 1.0f;
+  uint32_t samples = 1;
+  uint32_t supportedSamples = 1;
+  // Lowered when a sample count overshoots so it is not tried again every few seconds, raised back after a long calm
+  uint32_t sampleCeiling = 1;
+  uint32_t maxSamples = 1;
+  double averageMs = 0.0;
+  uint32_t frames = 0;
+  uint32_t calmFrames = 0;
+
+  void setBudget(double ms, uint32_t maxSamples);
+  Change update(double gpuMs);
+  void settle();
+};
+} // namespace renderScale
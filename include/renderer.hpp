@@ -5,12 +5,41 @@
 #include <SDL3/SDL_vulkan.h>
 #include <cstdint>
 #include <vulkan/vulkan.h>
+#include <array>
+#include <memory>
 #include <vector>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vulkan/vulkan_core.h>
 #include "player.hpp"
+#include "renderBackend.hpp"
 #include "vertex.hpp"
 #include "terrain.hpp"
+#include "meshArena.hpp"
+#include "deletionQueue.hpp"
+#include "framePacing.hpp"
+#include "gpuProfiler.hpp"
+#include "renderScale.hpp"
+#include "config.hpp"
+#include "culling.hpp"
+#include "fileHandler.hpp"
+#include "assetPack.hpp"
+#include "taskGraph.hpp"
+
+// Per frame resources exist this many times, the latency mode decides how many of them rotate
+const int MAX_FRAMES_IN_FLIGHT = 3;
+
+// Texture pixels waiting for the upload, viewing the asset pack or the decoded copy
+struct PendingTexture {
+  assetPack::TextureData decoded;
+  std::span<const unsigned char> pixels;
+  uint32_t width = 1;
+  uint32_t height = 1;
+  uint32_t layers = 1;
+  uint32_t mipLevels = 1;
+  bool blit = false;
+};
 
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
@@ -18,10 +47,71 @@ struct SwapChainSupportDetails {
   std::vector<VkPresentModeKHR> presentModes;
 };
 
-class Renderer {
+// Chunk slots drawn by one secondary command buffer per frame in flight, kept until the slots or the pipeline change
+struct ChunkGroup {
+  uint32_t firstChunk = 0;
+  uint32_t chunkCount = 0;
+  std::vector<VkCommandBuffer> commandBuffers;
+  // Depth only draws of the same slots, executed for every group before the colour ones
+  std::vector<VkCommandBuffer> depthCommandBuffers;
+  std::vector<uint32_t> recordedRenderType;
+};
+
+// Attribute streams of one glTF primitive back to back in a single buffer, offsets are in bytes
+struct GpuModel {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize positionOffset = 0;
+  VkDeviceSize normalOffset = 0;
+  VkDeviceSize texCoordOffset = 0;
+  VkDeviceSize indexOffset = 0;
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+  // Drawn in one instanced draw, every frame slot has its own host visible copy that is only rewritten after a change
+  std::vector<ModelInstance> instances;
+  uint64_t instancesVersion = 0;
+  uint32_t instanceCapacity = 0;
+  std::vector<VkBuffer> instanceBuffers;
+  std::vector<VkDeviceMemory> instanceBuffersMemory;
+  std::vector<void*> instanceBuffersMapped;
+  std::vector<uint64_t> uploadedVersion;
+};
+
+struct StagingBuffer {
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+};
+
+// Recorded at the start of the next frame instead of waiting for the queue to go idle
+struct StagedCopy {
+  VkBuffer source;
+  VkBuffer target;
+  VkBufferCopy region;
+};
+
+enum class VertexInput {
+  Chunk,
+  Model,
+};
+
+class Renderer : public RenderBackend {
 private:
   SDL_Window* window = nullptr;
-  bool currentFrame = 0;
+  // Renders into offscreen images instead of a swapchain, there is no window or surface
+  bool headless = false;
+  std::vector<VkDeviceMemory> offscreenImagesMemory;
+  uint32_t lastImage = 0;
+  uint32_t currentFrame = 0;
+  // Resources exist for the deepest mode, only the first framesInFlight of them rotate
+  uint32_t framesInFlight = 2;
+  // Frames are numbered from one as they are submitted, each slot remembers the one its fence belongs to
+  uint64_t submittedFrames = 0;
+  uint64_t presentedAt = 0;
+  uint64_t completedFrame = 0;
+  std::vector<uint64_t> slotFrames;
+  DeletionQueue deletionQueue;
+  framePacing::LatencyMode latencyMode = framePacing::LatencyMode::Balanced;
   VkInstance instance = NULL;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   uint32_t presentationFamilyIndices = 0;
@@ -40,22 +130,37 @@ private:
   std::vector<VkImage> swapChainImages = {};
   VkFormat swapChainImageFormat;
   VkExtent2D swapChainExtent;
-  std::vector<VkImageView> swapChainImageViews = {};
   std::vector<VkDynamicState> dynamicStates = {
     VK_DYNAMIC_STATE_VIEWPORT,
     VK_DYNAMIC_STATE_SCISSOR
   };
   VkRenderPass renderPass;
+  VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+  bool pipelineCacheWarm = false;
+  std::unordered_map<std::string, VkShaderModule> shaderModules;
+  // Mapped for the renderer's lifetime so models loaded later are lookups too
+  std::string assetPackPath = assetPack::defaultPath();
+  assetPack::Archive assets;
   VkDescriptorSetLayout descriptorSetLayout;
   std::vector<std::vector<VkPipelineLayout>> pipelineLayout = {{}, {}, {}, {}};
-  std::vector<VkFramebuffer> swapChainFramebuffers;
+  VkFramebuffer sceneFramebuffer;
   VkCommandPool commandPool;
+  std::vector<VkCommandPool> workerCommandPools;
+  std::unique_ptr<taskGraph::TaskGraph> recordWorkers;
+  std::vector<ChunkGroup> chunkGroups;
   std::vector<VkCommandBuffer> commandBuffers = {};
   std::vector<VkSemaphore> imageAvailableSemaphores = {};
   std::vector<VkSemaphore> renderFinishedSemaphores = {};
   std::vector<VkFence> inFlightFences = {};
   std::vector<std::vector<VkPipeline>> graphicsPipeline = {{}, {}, {}, {}};
+  VkPipelineLayout depthPipelineLayout;
+  VkPipeline depthPipeline;
+  VkPipelineLayout modelPipelineLayout;
+  VkPipeline modelPipeline;
+  std::vector<VkCommandBuffer> modelCommandBuffers;
+  bool depthPrepass = config::depthPrepass;
   bool framebufferResized = false;
+  GpuProfiler profiler;
   std::vector<VkBuffer> uniformBuffers;
   std::vector<VkDeviceMemory> uniformBuffersMemory;
   std::vector<void*> uniformBuffersMapped;
@@ -65,67 +170,189 @@ private:
   VkDeviceMemory textureImageMemory;
   VkImageView textureImageView;
   VkSampler textureSampler;
+  uint32_t textureMipLevels;
+  uint32_t textureLayers;
+  PendingTexture pendingTexture;
   VkImage depthImage;
   VkDeviceMemory depthImageMemory;
   VkImageView depthImageView;
   VkSampleCountFlagBits msaaSamples;
+  VkSampleCountFlagBits maxMsaaSamples;
   VkImage colorImage;
   VkDeviceMemory colorImageMemory;
   VkImageView colorImageView;
+  // The scene renders into the top left renderExtent of this image and is blitted up to the swapchain
+  VkImage sceneImage;
+  VkDeviceMemory sceneImageMemory;
+  VkImageView sceneImageView;
+  VkExtent2D renderExtent;
+  VkFilter upscaleFilter = VK_FILTER_LINEAR;
+  renderScale::Controller scaleController;
+  MeshArena meshArena;
+  std::vector<VkBuffer> indirectBuffers;
+  std::vector<VkDeviceMemory> indirectBuffersMemory;
+  std::vector<void*> indirectBuffersMapped;
+  VkBuffer chunkOriginBuffer;
+  VkDeviceMemory chunkOriginBufferMemory;
+  std::vector<GpuModel> models;
+  uint32_t drawCount = 0;
+  std::array<calc::Vec4, 6> frustumPlanes;
+  std::vector<uint32_t> visibleChunks;
+  bool sortChunks = config::sortChunks;
+  culling::DistanceSorter chunkSorter;
+  std::vector<uint8_t> reachableChunks;
+  bool gpuCulling = false;
+  bool allowGpuCulling = true;
+  uint32_t chunkCount = 0;
+  VkBuffer chunkBoundsBuffer;
+  VkDeviceMemory chunkBoundsBufferMemory;
+  VkBuffer chunkDrawsBuffer;
+  VkDeviceMemory chunkDrawsBufferMemory;
+  // Records of released chunks, patched in place by the next recorded frame instead of uploading them all again
+  std::vector<uint32_t> releasedChunkRecords;
+  std::vector<StagingBuffer> stagingBuffers;
+  std::vector<StagedCopy> stagedCopies;
+  std::vector<VkBuffer> culledDrawBuffers;
+  std::vector<VkDeviceMemory> culledDrawBuffersMemory;
+  std::vector<VkBuffer> drawCountBuffers;
+  std::vector<VkDeviceMemory> drawCountBuffersMemory;
+  std::vector<VkBuffer> reachableBuffers;
+  std::vector<VkDeviceMemory> reachableBuffersMemory;
+  std::vector<void*> reachableBuffersMapped;
+  VkDescriptorSetLayout cullDescriptorSetLayout;
+  std::vector<VkDescriptorSet> cullDescriptorSets;
+  VkPipelineLayout cullPipelineLayout;
+  VkPipeline cullPipeline;
 
   void createInstance();
   void createSurface();
   std::vector<VkDeviceQueueCreateInfo> pickPhysicalDevice();
   void createLogicalDevice(std::vector<VkDeviceQueueCreateInfo> queueCreateInfo);
   void createSwapChain();
-  void createImageViews();
   void createRenderPass();
   void createDescriptorSetLayout();
+  void createPipelineCache();
+  void savePipelineCache();
   void createGraphicalPipeline();
+  void destroyGraphicalPipelines();
   void createCommandPool();
+  void createWorkerCommandPools();
   void createColorResource();
   void createDepthResources();
+  void createSceneImage();
   void createFramebuffers();
+  void createRenderTargets();
+  void cleanupRenderTargets();
+  void decodeTextureImage();
   void createTextureImage();
   void createTextureImageView();
   void createTextureSampler();
   void createUniformBuffers();
+  void createMeshArena();
+  void createIndirectBuffers();
+  void createChunkOriginBuffer();
+  void createCullingResources();
+  void createCullPipeline();
   void createDescriptorPool();
   void createDescriptorSets();
+  void createCullDescriptorSets();
   void createCommandBuffers();
   void createSyncObjects();
+  void createProfiler();
+  void createOffscreenImages();
+  void initialize();
 
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
   VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
   VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
   VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
   std::vector<char> readFile(const std::string& filename);
-  VkShaderModule createShaderModule(const std::vector<char>& code, VkDevice device);
-  void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent, std::vector<VkPipelineLayout> pipelineLayout, std::vector<VkPipeline> pipeline, Terrain& terrain);
+  std::span<const char> loadAsset(const std::string& name, std::vector<char>& storage);
+  VkShaderModule createShaderModule(std::span<const char> code, VkDevice device);
+  VkShaderModule loadShaderModule(const std::string& name);
+  void destroyShaderModules();
+  void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent);
+  void updateChunkGroups(uint32_t slotCount);
+  void invalidateChunkGroups();
+  void recordChunkGroups(uint32_t renderType);
+  void recordChunkGroup(const ChunkGroup& group, uint32_t groupIndex, uint32_t frame, uint32_t renderType);
+  void beginChunkGroup(VkCommandBuffer commandBuffer);
+  void recordChunkDraws(VkCommandBuffer commandBuffer, const ChunkGroup& group, uint32_t frame, VkPipelineLayout layout);
+  bool usesDepthPrepass(uint32_t renderType) const;
+  void updateModelInstances(uint32_t frame);
+  bool recordModels(uint32_t frame);
   void recreateSwapChain();
   void cleanupSwapChain();
+  void updateRenderExtent();
+  void applySampleCount();
+  void adaptRenderScale();
+  void recordUpscale(VkCommandBuffer commandBuffer, uint32_t imageIndex);
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-  void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSample, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+  void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers, VkSampleCountFlagBits numSample, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-  void updateUniformBuffer(bool currentFrame, Player* player);
+  void updateUniformBuffer(uint32_t currentFrame, Player* player);
+  uint32_t updateDrawCommands(uint32_t currentFrame, const Terrain& terrain, const Player* player);
+  void uploadChunkRecords(const Terrain& terrain);
+  void uploadChunkOrigins(const Terrain& terrain);
+  void recordCulling(VkCommandBuffer commandBuffer);
+  // A new host visible buffer of the given size, stageCopy queues copies out of the newest one
+  char* stageUpload(VkDeviceSize size);
+  void stageCopy(VkBuffer target, VkBufferCopy region);
+  void recordUploads(VkCommandBuffer commandBuffer);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-  void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-  void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-  VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+  void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layers);
+  void copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
+  void generateMipmaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mipLevels, uint32_t layers);
+  VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t mipLevels, uint32_t layers);
   VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
   VkFormat findDepthFormat();
   bool hasStencilComponent(VkFormat format);
   VkSampleCountFlagBits getMaxUsableSampleCount();
-  std::pair<VkPipelineLayout, VkPipeline> createPipeline(const std::string& vertShader, const std::string& fragShader, const VkPolygonMode& polygonMode);
+  std::pair<VkPipelineLayout, VkPipeline> createPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const VkPolygonMode& polygonMode, VertexInput input);
 
 public:
-  Renderer(SDL_Window* window);
+  Renderer(SDL_Window* window, framePacing::LatencyMode latencyMode = framePacing::LatencyMode::Balanced);
+  // An empty asset pack path reads every asset from its own file, without gpuCulling chunks are culled on the CPU even when compute culling is supported
+  Renderer(uint32_t width, uint32_t height, const std::string& assetPackPath = assetPack::defaultPath(), bool gpuCulling = true);
   ~Renderer();
 
-  void drawFrame(Player* player, Terrain& terrain);
-  void windowResized();
-  void createVertexBuffer(const std::vector<Vertex>& vertices, VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory);
-  void createIndexBuffer(const std::vector<uint32_t>& indices, VkBuffer& indexBuffer, VkDeviceMemory& indexBufferMemory);
+  void drawFrame(Player* player, Terrain& terrain) override;
+  void windowResized() override;
+  void setLatencyMode(framePacing::LatencyMode mode) override;
+  framePacing::LatencyMode getLatencyMode() const override;
+  // A budget of 0 stops the render scale and MSAA from following the GPU time
+  void setFrameBudget(double ms);
+  void setRenderScale(float scale);
+  void setMsaaSamples(uint32_t samples);
+  float getRenderScale() const override;
+  uint32_t getMsaaSamples() const override;
+  void setDepthPrepass(bool enabled) override;
+  // Only the CPU culling path is ordered, compute culling compacts in whatever order its atomics give
+  void setChunkSorting(bool enabled);
+  bool hasPipelineStatistics() const;
+  double lastFragmentInvocations() const;
+  // Never waits on the GPU, the copies are recorded at the start of the next frame
+  void uploadTerrain(Terrain& terrain) override;
+  // Normals and texture coordinates are optional and zero when missing, positions and uint16 or uint32 indices are not
+  bool uploadModel(const fileHandler::glTFmodel& source, GpuModel& target);
+  void releaseModel(GpuModel& target);
+  // Index for setModelInstances, -1 when the file could not be used
+  int32_t loadModel(const std::string& path);
+  // Copied, the GPU copies follow on the next frame of each slot
+  void setModelInstances(uint32_t model, std::span<const ModelInstance> instances);
+  size_t modelCount() const;
+  // Freed once every frame submitted so far, and the one being recorded, has retired, never waits on the GPU
+  void releaseBuffer(VkBuffer buffer, VkDeviceMemory memory);
+  // Arena space is returned late and the chunk is uploaded again by the next uploadTerrain
+  void releaseChunkMesh(Terrain& terrain, uint32_t chunk) override;
+  size_t pendingDeletions() const;
+  bool hasGpuCulling() const;
+  // GPU time of the newest frame whose fence has been waited on, so it trails the CPU by the frames in flight
+  double lastGpuTimeMs() const override;
+  uint64_t lastPresentNs() const override;
+  std::string gpuReport() const override;
+  bool readFrame(std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height);
+  bool verifyGpuCulling(const Terrain& terrain);
 };
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace taskGraph {
+using Task = uint32_t;
+
+// Startup work with dependencies. Work runs on the pool as soon as everything it depends on finished,
+// callbacks run on the thread calling poll or wait, so they are the place for anything that touches the graphics queue.
+// A task can only depend on tasks added before it, so the graph never has a cycle
+class TaskGraph {
+public:
+  explicit TaskGraph(uint32_t threads = defaultThreads());
+  TaskGraph(const TaskGraph&) = delete;
+  TaskGraph& operator=(const TaskGraph&) = delete;
+  // Waits for everything still queued, callbacks included
+  ~TaskGraph();
+
+  // Names have to outlive the graph, they become profiler zones
+  Task add(const char* name, std::initializer_list<Task> dependencies, std::function<void()> work);
+  Task then(const char* name, std::initializer_list<Task> dependencies, std::function<void()> callback);
+
+  // Only becomes ready on its own when no callback is on the way to the task
+  std::shared_future<void> future(Task task) const;
+  bool done(Task task) const;
+  // Runs the callbacks that are ready without blocking, returns how many ran
+  size_t poll();
+  // Runs callbacks until the task has finished, only from the thread that owns the graph.
+  // A task that threw, or depends on one that did, rethrows here, its dependents are skipped with the same exception
+  void wait(Task task);
+  // Rethrows the first exception any task threw
+  void waitAll();
+  // Forgets every task so a graph used over and over does not keep growing, task numbers start again from 0.
+  // Only once everything has finished
+  void clear();
+
+  static uint32_t defaultThreads();
+
+private:
+  struct Node {
+    const char* name;
+    std::function<void()> work;
+    bool callback;
+    uint32_t pending = 0;
+    bool finished = false;
+    std::vector<Task> dependents;
+    std::exception_ptr error;
+    std::promise<void> promise;
+    std::shared_future<void> future;
+  };
+
+  // A deque so nodes stay put while others are added
+  std::deque<Node> nodes;
+  std::deque<Task> workQueue;
+  std::deque<Task> callbackQueue;
+  std::vector<std::thread> workers;
+  mutable std::mutex mutex;
+  std::condition_variable workReady;
+  std::condition_variable callbackReady;
+  size_t unfinished = 0;
+  std::exception_ptr firstError;
+  bool stopping = false;
+
+  Task insert(const char* name, std::initializer_list<Task> dependencies, std::function<void()> work, bool callback);
+  void schedule(Task task);
+  void execute(Task task);
+  void workerLoop();
+  // Checked with the lock held
+  void runCallbacksUntil(const std::function<bool()>& finished);
+};
+} // namespace taskGraph
@@ -5,19 +5,33 @@
 #include <vulkan/vulkan.h>
 #include "vertex.hpp"
 #include "chunk.hpp"
+#include "meshArena.hpp"
+#include "culling.hpp"
+#include "visibility.hpp"
 #include <vector>
 
+// Vertices and indices are local to the chunk, the arena offsets are filled on upload
+struct ChunkMesh {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  ArenaRange vertexRange;
+  ArenaRange indexRange;
+  visibility::Connectivity connectivity = 0;
+  bool uploaded = false;
+};
+
 class Terrain {
 private:
   void gridyMesher(const std::vector<Chunk>& chunks);
 
 public:
-  VkBuffer vertexBuffer;
-  VkDeviceMemory vertexBufferMemory;
-  VkBuffer indexBuffer;
-  VkDeviceMemory indexBufferMemory;
-  std::vector<Vertex> vertices;
-  std::vector<uint32_t> indices;
+  std::vector<Chunk> chunks;
+  std::vector<ChunkMesh> meshes;
+  culling::ChunkBounds bounds;
+  visibility::ChunkGraph graph;
 
   Terrain();
+
+  // Chunk coordinates are block coordinates shifted right by 4, nullptr outside the generated world
+  const Chunk* chunkAt(int chunkX, int chunkY, int chunkZ) const;
 };
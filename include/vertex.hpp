@@ -1,6 +1,9 @@
 #pragma once
 
 #include "calc.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <vulkan/vulkan.h>
 
 class Vertex {
@@ -8,7 +11,7 @@ public:
   calc::Vec4 pos;
   calc::Vec4 col;
   calc::Vec2 texCoord;
-  calc::Vec4 norm;
+  calc::Vec4 norm; // w is the layer in the block texture array
 
   static VkVertexInputBindingDescription getBindingDescription() {
     VkVertexInputBindingDescription bindingDescription{};
@@ -42,3 +45,47 @@ public:
   }
 };
 
+
+// Rows of a 3x4 transform relative to the instance's chunk, read once per instance next to the model's own position, normal and uv streams.
+// The chunk is kept as integers like the terrain's origins, so entities far from the world origin are as steady as the blocks around them
+class ModelInstance {
+public:
+  calc::Vec4 rows[3];
+  std::array<int32_t, 4> chunk;
+
+  // Uniform scale and a turn around y, which is all entities need for now
+  static ModelInstance at(double x, double y, double z, float scale = 1.0f, float yaw = 0.0f) {
+    std::array<int32_t, 4> chunk = {static_cast<int32_t>(std::floor(x / 16.0)), static_cast<int32_t>(std::floor(y / 16.0)), static_cast<int32_t>(std::floor(z / 16.0)), 0};
+    float ox = static_cast<float>(x - chunk[0] * 16.0), oy = static_cast<float>(y - chunk[1] * 16.0), oz = static_cast<float>(z - chunk[2] * 16.0);
+
+    float c = std::cos(yaw) * scale, s = std::sin(yaw) * scale;
+    return {{calc::Vec4(c, 0.0f, s, ox), calc::Vec4(0.0f, scale, 0.0f, oy), calc::Vec4(-s, 0.0f, c, oz)}, chunk};
+  }
+
+  static std::array<VkVertexInputBindingDescription, 4> getBindingDescriptions() {
+    std::array<VkVertexInputBindingDescription, 4> bindingDescriptions{};
+    const uint32_t strides[] = {sizeof(float) * 3, sizeof(float) * 3, sizeof(float) * 2, sizeof(ModelInstance)};
+
+    for(uint32_t i = 0; i < bindingDescriptions.size(); ++i) {
+      bindingDescriptions[i].binding = i;
+      bindingDescriptions[i].stride = strides[i];
+      bindingDescriptions[i].inputRate = i == 3 ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
+    }
+
+    return bindingDescriptions;
+  }
+
+  static std::array<VkVertexInputAttributeDescription, 7> getAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, 7> attributeDescriptions{};
+    attributeDescriptions[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0};
+    attributeDescriptions[1] = {1, 1, VK_FORMAT_R32G32B32_SFLOAT, 0};
+    attributeDescriptions[2] = {2, 2, VK_FORMAT_R32G32_SFLOAT, 0};
+
+    for(uint32_t i = 0; i < 3; ++i) {
+      attributeDescriptions[3 + i] = {3 + i, 3, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(sizeof(calc::Vec4) * i)};
+    }
+    attributeDescriptions[6] = {6, 3, VK_FORMAT_R32G32B32A32_SINT, static_cast<uint32_t>(sizeof(calc::Vec4) * 3)};
+
+    return attributeDescriptions;
+  }
+};
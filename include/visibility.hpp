@@ -0,0 +1,42 @@
+#pragma once
+
+#include "chunk.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace visibility {
+// Same order as the mesher directions, the opposite face is always 3 away
+enum Face : uint8_t {
+  NegativeY = 0,
+  NegativeX = 1,
+  NegativeZ = 2,
+  PositiveY = 3,
+  PositiveX = 4,
+  PositiveZ = 5,
+  None = 6
+};
+
+// Bit a * 6 + b is set when air inside the chunk connects face a to face b
+using Connectivity = uint64_t;
+
+Connectivity faceConnectivity(const Chunk& chunk);
+bool connected(Connectivity connectivity, Face a, Face b);
+
+// Chunks on a grid, walked from the camera through faces that air connects
+class ChunkGraph {
+public:
+  int minX = 0, minY = 0, minZ = 0;
+  int sizeX = 0, sizeY = 0, sizeZ = 0;
+  std::vector<int32_t> slots;
+  std::vector<Connectivity> connectivity;
+
+  void build(const std::vector<Chunk>& chunks, const std::vector<Connectivity>& connectivity);
+  // Index into the chunks the graph was built from, -1 where there is none
+  int32_t chunkAt(int chunkX, int chunkY, int chunkZ) const;
+  // Marks chunks a line of sight from the camera could reach, returns how many
+  size_t potentiallyVisible(float x, float y, float z, std::vector<uint8_t>& visible) const;
+
+private:
+  int cell(int x, int y, int z) const;
+};
+} // namespace visibility
@@ -18,17 +18,92 @@
 #include <SDL3/SDL_vulkan.h>
 #include <vulkan/vulkan.h>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <vulkan/vulkan_core.h>
 #include "./include/terrain.hpp"
+#include "./include/assetPack.hpp"
+#include "./include/benchmark.hpp"
+#include "./include/config.hpp"
+#include "./include/framePacing.hpp"
+#include "./include/frameStats.hpp"
+#include "./include/game.hpp"
+#include "./include/profiler.hpp"
+#include "./include/taskGraph.hpp"
+#include <optional>
 
 #define windowWidth 800
 #define windowHeight 600
 
 int main(int argc, char *argv[]) {
+  if(argc > 1 && std::string(argv[1]).starts_with("--bench-")) {
+    return benchmark::run(std::string(argv[1]).substr(8), std::vector<std::string>(argv + 2, argv + argc));
+  }
+
+  // --build-pack [file] packs the assets under config::assetRoot, next to the executable by default
+  if(argc > 1 && std::string(argv[1]) == "--build-pack") {
+    return assetPack::build(argc > 2 ? argv[2] : assetPack::defaultPath()) ? 0 : 1;
+  }
+
+  PROFILE_THREAD("main");
+
+  // --latency=low|balanced|throughput, --fps-cap=<fps>, --trace=<file> and --frame-report=<file> written at exit
+  // --gpu-budget=<ms> for the adaptive render scale, --render-scale=<0.5-1> and --msaa=<samples> pin them instead
+  framePacing::LatencyMode latencyMode = framePacing::LatencyMode::Balanced;
+  framePacing::FrameLimiter limiter;
+  framePacing::LatencyTracker latency;
+  std::string tracePath;
+  std::string frameReportPath;
+  double gpuBudget = -1.0;
+  float fixedScale = 0.0f;
+  uint32_t fixedSamples = 0;
+  frameStats::FrameReporter frameReporter;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if(arg.starts_with("--latency=") && !framePacing::parse(arg.substr(10), latencyMode)) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Unknown latency mode: %s\n", arg.substr(10).c_str());
+      return 1;
+    }
+
+    if(arg.starts_with("--fps-cap=")) {
+      limiter.fpsCap = std::atof(arg.substr(10).c_str());
+    }
+
+    if(arg.starts_with("--trace=")) {
+      tracePath = arg.substr(8);
+    }
+
+    if(arg.starts_with("--frame-report=")) {
+      frameReportPath = arg.substr(15);
+    }
+
+    if(arg.starts_with("--gpu-budget=")) {
+      gpuBudget = std::atof(arg.substr(13).c_str());
+    }
+
+    if(arg.starts_with("--render-scale=")) {
+      fixedScale = static_cast<float>(std::atof(arg.substr(15).c_str()));
+    }
+
+    if(arg.starts_with("--msaa=")) {
+      fixedSamples = static_cast<uint32_t>(std::atoi(arg.substr(7).c_str()));
+    }
+  }
+
+  // The world is generated and meshed on a worker while the window and the renderer start, the first frame waits for both
+  // Declared first so it outlives the graph, whose destructor waits for the worker still writing it on an early return
+  std::optional<Terrain> generated;
+  taskGraph::TaskGraph startup;
+  taskGraph::Task world = startup.add("generate world", {}, [&generated] {
+    generated.emplace();
+  });
+
   SDL_Init(SDL_INIT_VIDEO);
 
   bool shouldClose = false;
+  Uint64 lastPresent = 0;
   Uint64 lastCheck = SDL_GetPerformanceCounter(), fpsTime = lastCheck, t, freq;
   int frames = 0;
 
@@ -39,20 +114,44 @@ int main(int argc, char *argv[]) {
   }
 
   {// Scope made just for destructing renderer before window
-    Renderer renderer(window);
+    Renderer vulkan(window, latencyMode);
+
+    if(gpuBudget >= 0.0) {
+      vulkan.setFrameBudget(gpuBudget);
+    }
+
+    if(fixedScale > 0.0f || fixedSamples > 0) {
+      vulkan.setFrameBudget(0.0);
+    }
+
+    if(fixedScale > 0.0f) {
+      vulkan.setRenderScale(fixedScale);
+    }
+
+    if(fixedSamples > 0) {
+      vulkan.setMsaaSamples(fixedSamples);
+    }
+
+    // Past the settings above the loop only needs what every backend has
+    RenderBackend& renderer = vulkan;
 
     if (!SDL_SetWindowRelativeMouseMode(window, true)) {
       SDL_Log("Could not enable relative mouse mode: %s", SDL_GetError());
       return 1;
     }
 
+    bool depthPrepass = config::depthPrepass;
     Player player(0.0f, 0.0f, 2.0f);
-    Terrain terrain = Terrain();
-    renderer.createVertexBuffer(terrain.vertices, terrain.vertexBuffer, terrain.vertexBufferMemory);
-    renderer.createIndexBuffer(terrain.indices, terrain.indexBuffer, terrain.indexBufferMemory);
+    startup.wait(world);
+    Terrain terrain = std::move(*generated);
+    generated.reset();
+    renderer.uploadTerrain(terrain);
+    player.placeOnGround(terrain);
 
     SDL_Event event;
     while (!shouldClose) {  
+      PROFILE_ZONE("frame");
+      uint64_t frameStart = profiler::now();
       t = SDL_GetPerformanceCounter();
       freq = SDL_GetPerformanceFrequency();
       ++frames;
@@ -61,11 +160,13 @@ int main(int argc, char *argv[]) {
       lastCheck = t;
 
       if(t - fpsTime >= freq) {
-        std::cout << std::to_string(frames * freq / (t - fpsTime)) << '\r';
+        std::cout << std::to_string(frames * freq / (t - fpsTime)) << " fps, gpu " << renderer.lastGpuTimeMs() << " ms at " << renderer.getRenderScale() << "x " << renderer.getMsaaSamples() << "xMSAA, input latency " << latency.averageMs() << " ms avg " << latency.maximumMs() << " ms max   \r";
         fpsTime = t;
         frames = 0;
+        latency.reset();
       }
 
+      float mouseDx = 0.0f, mouseDy = 0.0f;
       while (SDL_PollEvent(&event)) {
         if(event.type == SDL_EVENT_QUIT) {
           shouldClose = true;
@@ -75,15 +176,68 @@ int main(int argc, char *argv[]) {
           renderer.windowResized();
         }
 
+        if(event.type == SDL_EVENT_MOUSE_MOTION || event.type == SDL_EVENT_KEY_DOWN) {
+          latency.input(event.common.timestamp);
+        }
+
+        if(event.type == SDL_EVENT_MOUSE_MOTION) {
+          mouseDx += event.motion.xrel;
+          mouseDy += event.motion.yrel;
+        }
+
+        if(event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_L) {
+          renderer.setLatencyMode(framePacing::next(renderer.getLatencyMode()));
+        }
+
+        if(event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_G) {
+          SDL_Log("GPU over the last frames:\n%s", renderer.gpuReport().c_str());
+        }
+
+        if(event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_T) {
+          profiler::writeChromeTrace(config::tracePath);
+        }
+
+        if(event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_O) {
+          depthPrepass = !depthPrepass;
+          renderer.setDepthPrepass(depthPrepass);
+        }
+
         player.handleEvent(event);
       }
-      player.handleInput(dt);
+
+      // The keyboard state follows the events just polled
+      game::Input input = game::keyboard();
+      input.dx = mouseDx;
+      input.dy = mouseDy;
 
       // FIX: textures go uuf when using greedymeshing
-      renderer.drawFrame(&player, terrain);
+      game::frame(renderer, player, terrain, input, dt);
+
+      // Stamped by the renderer as present returned, a frame that was not presented leaves it as it was
+      if(renderer.lastPresentNs() != lastPresent) {
+        lastPresent = renderer.lastPresentNs();
+        latency.presented(lastPresent);
+      }
+
+      {
+        PROFILE_ZONE("frame limiter");
+        limiter.wait();
+      }
+
+      frameReporter.frame(frameStart, profiler::now());
     }
   }
 
+  if(!tracePath.empty()) {
+    profiler::writeChromeTrace(tracePath);
+  }
+
+  if(!frameReportPath.empty()) {
+    frameReporter.write(frameReportPath);
+  } else {
+    std::cout << '\n' << frameReporter.report();
+  }
+
   SDL_DestroyWindow(window);
   SDL_Quit();
   return 0;
@@ -1,9 +1,9 @@
 #version 450
 
-layout(binding = 1) uniform sampler2D texSampler;
+layout(binding = 1) uniform sampler2DArray texSampler;
 
 layout(location = 0) in vec4 fragColor;
-layout(location = 1) in vec2 fragTexCoord;
+layout(location = 1) in vec3 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
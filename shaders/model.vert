@@ -0,0 +1,31 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+  mat4 viewProj;
+  vec4 frustum[6];
+  ivec4 cameraChunk;
+  vec4 cameraOffset;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+// Rows of the instance's 3x4 transform, relative to its chunk
+layout(location = 3) in vec4 row0;
+layout(location = 4) in vec4 row1;
+layout(location = 5) in vec4 row2;
+layout(location = 6) in ivec4 instanceChunk;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec3 fragTexCoord;
+
+void main() {
+  vec4 local = vec4(inPosition, 1.0);
+  vec3 inChunk = vec3(dot(row0, local), dot(row1, local), dot(row2, local));
+
+  // Chunks are subtracted as integers first, the same as the terrain, so the float part stays small anywhere in the world
+  vec3 position = vec3((instanceChunk.xyz - ubo.cameraChunk.xyz) * 16) + inChunk - ubo.cameraOffset.xyz;
+  gl_Position = ubo.viewProj * vec4(position, 1.0);
+  fragColor = vec4(normalize(vec3(dot(row0.xyz, inNormal), dot(row1.xyz, inNormal), dot(row2.xyz, inNormal))), 1.0);
+  fragTexCoord = vec3(inTexCoord, 0.0);
+}
@@ -1,22 +1,31 @@
 #version 450
 
 layout(binding = 0) uniform UniformBufferObject {
-  mat4 model;
-  mat4 trans;
-  mat4 rot;
-  mat4 proj;
+  mat4 viewProj;
+  vec4 frustum[6];
+  ivec4 cameraChunk;
+  vec4 cameraOffset;
 } ubo;
 
+layout(std430, binding = 2) readonly buffer ChunkOrigins {
+  ivec4 origins[];
+};
+
 layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec4 inColor;
 layout(location = 2) in vec2 inTexCoord;
+// w picks the layer of the block texture array
 layout(location = 3) in vec4 normal;
 
 layout(location = 0) out vec4 fragColor;
-layout(location = 1) out vec2 fragTexCoord;
+layout(location = 1) out vec3 fragTexCoord;
+// The depth pre-pass and the colour pass have to produce bit identical depth
+invariant gl_Position;
 
 void main() {
-  gl_Position = ubo.proj * ubo.rot * ubo.trans * ubo.model * inPosition;
+  // Chunks are subtracted as integers first so the float part stays small anywhere in the world
+  vec3 position = vec3((origins[gl_InstanceIndex].xyz - ubo.cameraChunk.xyz) * 16) + inPosition.xyz - ubo.cameraOffset.xyz;
+  gl_Position = ubo.viewProj * vec4(position, 1.0);
   fragColor = inColor;
-  fragTexCoord = inTexCoord;
+  fragTexCoord = vec3(inTexCoord, normal.w);
 }
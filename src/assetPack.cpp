@@ -0,0 +1,349 @@
+#include "../include/assetPack.hpp"
+
+#include "../include/config.hpp"
+#include "../include/profiler.hpp"
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_surface.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace assetPack {
+size_t levelSize(uint32_t width, uint32_t height, uint32_t level) {
+  return static_cast<size_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+}
+
+size_t textureSize(uint32_t width, uint32_t height, uint32_t layers, uint32_t mipLevels) {
+  size_t size = 0;
+  for(uint32_t level = 0; level < mipLevels; ++level) {
+    size += levelSize(width, height, level);
+  }
+
+  return size * layers;
+}
+
+std::vector<uint8_t> downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+  static const std::array<float, 256> toLinear = [] {
+    std::array<float, 256> table{};
+    for(size_t i = 0; i < table.size(); ++i) {
+      float c = i / 255.0f;
+      table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+  }();
+
+  uint32_t mipWidth = std::max(width / 2, 1u), mipHeight = std::max(height / 2, 1u);
+  std::vector<uint8_t> result(mipWidth * mipHeight * 4);
+
+  for(uint32_t y = 0; y < mipHeight; ++y) {
+    for(uint32_t x = 0; x < mipWidth; ++x) {
+      for(uint32_t c = 0; c < 4; ++c) {
+        float sum = 0.0f;
+        for(uint32_t i = 0; i < 4; ++i) {
+          uint32_t sx = std::min(x * 2 + (i & 1), width - 1), sy = std::min(y * 2 + (i >> 1), height - 1);
+          uint8_t value = pixels[(sy * width + sx) * 4 + c];
+          sum += c == 3 ? value / 255.0f : toLinear[value];
+        }
+
+        float average = sum / 4.0f;
+        if(c != 3) {
+          average = average <= 0.0031308f ? average * 12.92f : 1.055f * std::pow(average, 1.0f / 2.4f) - 0.055f;
+        }
+        result[(y * mipWidth + x) * 4 + c] = static_cast<uint8_t>(std::lround(std::clamp(average, 0.0f, 1.0f) * 255.0f));
+      }
+    }
+  }
+
+  return result;
+}
+
+TextureData decodeTextures(const std::vector<std::string>& paths, bool mipmapped) {
+  PROFILE_ZONE("decode textures");
+  TextureData texture;
+  std::vector<SDL_Surface*> surfaces;
+  int width = 1, height = 1;
+
+  for(const std::string& path : paths) {
+    SDL_Surface* surface = SDL_LoadPNG(path.c_str());
+    SDL_Surface* converted = surface ? SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32) : nullptr;
+    SDL_DestroySurface(surface);
+
+    if(converted == nullptr) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not load image %s\n", path.c_str());
+      continue;
+    }
+
+    width = std::max(width, converted->w);
+    height = std::max(height, converted->h);
+    surfaces.push_back(converted);
+  }
+
+  // Every layer of an array image has the same size, nearest keeps the pixel art sharp
+  for(size_t i = 0; i < surfaces.size();) {
+    if(surfaces[i]->w != width || surfaces[i]->h != height) {
+      SDL_Surface* scaled = SDL_ScaleSurface(surfaces[i], width, height, SDL_SCALEMODE_NEAREST);
+      SDL_DestroySurface(surfaces[i]);
+
+      if(scaled == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not scale texture layer %zu: %s\n", i, SDL_GetError());
+        surfaces.erase(surfaces.begin() + i);
+        continue;
+      }
+
+      surfaces[i] = scaled;
+    }
+
+    ++i;
+  }
+
+  texture.width = static_cast<uint32_t>(width);
+  texture.height = static_cast<uint32_t>(height);
+  texture.layers = std::max(static_cast<uint32_t>(surfaces.size()), 1u);
+  texture.mipLevels = mipmapped ? static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1 : 1;
+  texture.pixels.reserve(textureSize(texture.width, texture.height, texture.layers, texture.mipLevels));
+
+  for(uint32_t layer = 0; layer < texture.layers; ++layer) {
+    std::vector<uint8_t> pixels(width * height * 4, 255);
+    if(layer < surfaces.size()) {
+      for(int y = 0; y < height; ++y) {
+        memcpy(pixels.data() + y * width * 4, static_cast<uint8_t*>(surfaces[layer]->pixels) + y * surfaces[layer]->pitch, width * 4);
+      }
+    }
+
+    uint32_t mipWidth = texture.width, mipHeight = texture.height;
+    for(uint32_t level = 0; level < texture.mipLevels; ++level) {
+      if(level > 0) {
+        pixels = downsample(pixels, mipWidth, mipHeight);
+        mipWidth = std::max(mipWidth / 2, 1u);
+        mipHeight = std::max(mipHeight / 2, 1u);
+      }
+
+      texture.pixels.insert(texture.pixels.end(), pixels.begin(), pixels.end());
+    }
+  }
+
+  for(SDL_Surface* surface : surfaces) {
+    SDL_DestroySurface(surface);
+  }
+
+  return texture;
+}
+
+Archive::Archive(const std::string& path) : file(path) {
+  if(!file.isOpen()) {
+    return;
+  }
+
+  Header header;
+  if(file.size < sizeof(header)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read asset pack %s: too short\n", path.c_str());
+    return;
+  }
+  memcpy(&header, file.data, sizeof(header));
+
+  if(header.magic != magicValue || header.version != version || header.size != file.size) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read asset pack %s: wrong version or truncated, rebuild it with --build-pack\n", path.c_str());
+    return;
+  }
+
+  if(header.indexOffset % alignof(Entry) != 0 || header.indexOffset > file.size || header.entryCount > (file.size - header.indexOffset) / sizeof(Entry)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read asset pack %s: index out of bounds\n", path.c_str());
+    return;
+  }
+
+  std::span<const Entry> index(reinterpret_cast<const Entry*>(file.data + header.indexOffset), header.entryCount);
+  for(const Entry& entry : index) {
+    bool named = memchr(entry.name, '\0', sizeof(entry.name)) != nullptr;
+    bool inside = entry.offset <= file.size && entry.size <= file.size - entry.offset;
+    bool texture = entry.kind != Kind::Texture || entry.size == textureSize(entry.width, entry.height, entry.layers, entry.mipLevels);
+
+    if(!named || !inside || !texture) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read asset pack %s: broken entry\n", path.c_str());
+      return;
+    }
+  }
+
+  entries = index;
+
+  // Only files that are there are compared, a pack shipped without its sources is always current
+  stale.assign(entries.size(), false);
+  for(size_t i = 0; i < entries.size(); ++i) {
+    if(modified(sources(entries[i].name)) > entries[i].modified) {
+      SDL_Log("%s changed after the asset pack was built, reading the loose file", entries[i].name);
+      stale[i] = true;
+    }
+  }
+}
+
+bool Archive::isOpen() const {
+  return !entries.empty();
+}
+
+const Entry* Archive::find(std::string_view name) const {
+  auto it = std::lower_bound(entries.begin(), entries.end(), name, [](const Entry& entry, std::string_view name) {
+    return std::string_view(entry.name) < name;
+  });
+
+  if(it == entries.end() || std::string_view(it->name) != name || stale[it - entries.begin()]) {
+    return nullptr;
+  }
+
+  return &*it;
+}
+
+std::span<const unsigned char> Archive::bytes(const Entry& entry) const {
+  return file.bytes().subspan(entry.offset, entry.size);
+}
+
+std::vector<std::string> sources(std::string_view name) {
+  if(name != blockTextures) {
+    return {config::assetRoot + std::string(name)};
+  }
+
+  std::vector<std::string> layers;
+  for(const std::string& layer : config::textureLayers) {
+    layers.push_back(config::assetRoot + layer);
+  }
+
+  return layers;
+}
+
+int64_t modified(const std::vector<std::string>& paths) {
+  int64_t newest = 0;
+
+  for(const std::string& path : paths) {
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    if(!error) {
+      // The file clock's epoch is up to the library, the system one is not
+      std::chrono::nanoseconds since = std::chrono::file_clock::to_sys(time).time_since_epoch();
+      newest = std::max(newest, static_cast<int64_t>(since.count()));
+    }
+  }
+
+  return newest;
+}
+
+std::string defaultPath() {
+  const char* base = SDL_GetBasePath();
+  return (base ? std::string(base) : std::string()) + config::assetPackName;
+}
+
+struct PendingEntry {
+  Entry entry;
+  std::vector<uint8_t> data;
+};
+
+bool readWhole(const std::string& path, std::vector<uint8_t>& data) {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if(!file.is_open()) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read file %s\n", path.c_str());
+    return false;
+  }
+
+  data.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(data.data()), data.size());
+  return static_cast<bool>(file);
+}
+
+bool add(std::vector<PendingEntry>& pending, const std::string& name, Kind kind, std::vector<uint8_t> data) {
+  if(name.size() >= sizeof(Entry::name)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not pack %s: name longer than %zu characters\n", name.c_str(), sizeof(Entry::name) - 1);
+    return false;
+  }
+
+  PendingEntry next{};
+  memcpy(next.entry.name, name.data(), name.size());
+  next.entry.kind = kind;
+  next.entry.size = data.size();
+  next.data = std::move(data);
+  pending.push_back(std::move(next));
+  return true;
+}
+
+bool build(const std::string& path) {
+  std::vector<PendingEntry> pending;
+  std::vector<uint8_t> data;
+
+  std::error_code error;
+  for(const auto& file : std::filesystem::directory_iterator(config::assetRoot + "shaders", error)) {
+    if(file.path().extension() != ".spv") {
+      continue;
+    }
+
+    if(!readWhole(file.path().string(), data) || !add(pending, "shaders/" + file.path().filename().string(), Kind::Shader, std::move(data))) {
+      return false;
+    }
+  }
+
+  if(error) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not list shaders: %s\n", error.message().c_str());
+    return false;
+  }
+
+  TextureData texture = decodeTextures(sources(blockTextures), true);
+  if(!add(pending, std::string(blockTextures), Kind::Texture, std::move(texture.pixels))) {
+    return false;
+  }
+  pending.back().entry.width = texture.width;
+  pending.back().entry.height = texture.height;
+  pending.back().entry.layers = texture.layers;
+  pending.back().entry.mipLevels = texture.mipLevels;
+
+  if(!readWhole(config::assetRoot + config::modelPath, data) || !add(pending, config::modelPath, Kind::Model, std::move(data))) {
+    return false;
+  }
+
+  for(PendingEntry& next : pending) {
+    next.entry.modified = modified(sources(next.entry.name));
+  }
+
+  std::sort(pending.begin(), pending.end(), [](const PendingEntry& a, const PendingEntry& b) {
+    return std::string_view(a.entry.name) < std::string_view(b.entry.name);
+  });
+
+  // Header, index, then every entry on its own boundary
+  Header header{magicValue, version, static_cast<uint32_t>(pending.size()), static_cast<uint32_t>(alignment), sizeof(Header), 0};
+  uint64_t offset = sizeof(Header) + pending.size() * sizeof(Entry);
+  for(PendingEntry& next : pending) {
+    offset = (offset + alignment - 1) & ~uint64_t(alignment - 1);
+    next.entry.offset = offset;
+    offset += next.entry.size;
+  }
+  header.size = offset;
+
+  std::vector<uint8_t> pack(header.size, 0);
+  memcpy(pack.data(), &header, sizeof(header));
+  for(size_t i = 0; i < pending.size(); ++i) {
+    memcpy(pack.data() + sizeof(Header) + i * sizeof(Entry), &pending[i].entry, sizeof(Entry));
+    memcpy(pack.data() + pending[i].entry.offset, pending[i].data.data(), pending[i].data.size());
+  }
+
+  // Written aside and moved over, a running game never maps a half written pack
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(pack.data()), pack.size());
+    if(!out) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not write asset pack %s\n", temporary.c_str());
+      return false;
+    }
+  }
+
+  std::filesystem::rename(temporary, path, error);
+  if(error) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not move asset pack to %s: %s\n", path.c_str(), error.message().c_str());
+    return false;
+  }
+
+  SDL_Log("Packed %zu assets into %s (%zu bytes)", pending.size(), path.c_str(), pack.size());
+  return true;
+}
+} // namespace assetPack
@@ -0,0 +1,359 @@
+#include "../include/batch.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BATCH_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BATCH_NEON
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BATCH_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+// Every path evaluates ((a * x + b * y) + c * z) + d in that order, so they all agree to the bit
+namespace batch {
+Path bestPath() {
+#ifdef BATCH_AVX2
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  if(avx2) {
+    return Path::Avx2;
+  }
+#endif
+
+#if defined(BATCH_SSE) || defined(BATCH_NEON)
+  return Path::Wide;
+#else
+  return Path::Scalar;
+#endif
+}
+
+const char* name(Path path) {
+  switch(path) {
+    case Path::Scalar: return "scalar";
+    case Path::Wide: return "sse/neon";
+    case Path::Avx2: return "avx2";
+  }
+
+  return "unknown";
+}
+
+inline float planeDistance(const calc::Vec4& plane, float x, float y, float z) {
+  return ((plane.x * x + plane.y * y) + plane.z * z) + plane.w;
+}
+
+// Corner furthest along the normal, picked per plane so every lane reads the same arrays
+struct PlaneCorner {
+  const float* xs;
+  const float* ys;
+  const float* zs;
+};
+
+// A frustum has six planes, only callers with more than this pay for a heap buffer
+constexpr size_t cornerSlots = 8;
+
+void furthestCorners(std::span<const calc::Vec4> planes, const Boxes& boxes, std::span<PlaneCorner> corners) {
+  for(size_t p = 0; p < planes.size(); ++p) {
+    corners[p].xs = planes[p].x > 0.0f ? boxes.maxX : boxes.minX;
+    corners[p].ys = planes[p].y > 0.0f ? boxes.maxY : boxes.minY;
+    corners[p].zs = planes[p].z > 0.0f ? boxes.maxZ : boxes.minZ;
+  }
+}
+
+void pushLanes(uint32_t mask, size_t first, std::vector<uint32_t>& inside) {
+  while(mask) {
+    inside.push_back(static_cast<uint32_t>(first + std::countr_zero(mask)));
+    mask &= mask - 1;
+  }
+}
+
+// Scalar tails of every path, and the whole of the scalar one
+void transformScalar(const calc::Mat4& m, const Points& points, float* outX, float* outY, float* outZ, size_t i) {
+  for(; i < points.count; ++i) {
+    float x = points.xs[i], y = points.ys[i], z = points.zs[i];
+    outX[i] = ((m[0] * x + m[4] * y) + m[8] * z) + m[12];
+    outY[i] = ((m[1] * x + m[5] * y) + m[9] * z) + m[13];
+    outZ[i] = ((m[2] * x + m[6] * y) + m[10] * z) + m[14];
+  }
+}
+
+void boxesScalar(std::span<const calc::Vec4> planes, std::span<const PlaneCorner> corners, const Boxes& boxes, std::vector<uint32_t>& inside, size_t i) {
+  for(; i < boxes.count; ++i) {
+    bool visible = true;
+
+    for(size_t p = 0; p < planes.size() && visible; ++p) {
+      visible = planeDistance(planes[p], corners[p].xs[i], corners[p].ys[i], corners[p].zs[i]) >= 0.0f;
+    }
+
+    if(visible) {
+      inside.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+void spheresScalar(std::span<const calc::Vec4> planes, const Spheres& spheres, std::vector<uint32_t>& inside, size_t i) {
+  for(; i < spheres.count; ++i) {
+    bool visible = true;
+
+    for(size_t p = 0; p < planes.size() && visible; ++p) {
+      visible = planeDistance(planes[p], spheres.xs[i], spheres.ys[i], spheres.zs[i]) >= -spheres.radii[i];
+    }
+
+    if(visible) {
+      inside.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+#if defined(BATCH_SSE)
+inline __m128 distanceWide(const calc::Vec4& plane, __m128 x, __m128 y, __m128 z) {
+  __m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y));
+  return _mm_add_ps(_mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.z), z)), _mm_set1_ps(plane.w));
+}
+
+size_t transformWide(const calc::Mat4& m, const Points& points, float* outX, float* outY, float* outZ) {
+  size_t i = 0;
+
+  for(; i + 4 <= points.count; i += 4) {
+    __m128 x = _mm_loadu_ps(points.xs + i), y = _mm_loadu_ps(points.ys + i), z = _mm_loadu_ps(points.zs + i);
+    _mm_storeu_ps(outX + i, distanceWide({m[0], m[4], m[8], m[12]}, x, y, z));
+    _mm_storeu_ps(outY + i, distanceWide({m[1], m[5], m[9], m[13]}, x, y, z));
+    _mm_storeu_ps(outZ + i, distanceWide({m[2], m[6], m[10], m[14]}, x, y, z));
+  }
+
+  return i;
+}
+
+size_t boxesWide(std::span<const calc::Vec4> planes, std::span<const PlaneCorner> corners, const Boxes& boxes, std::vector<uint32_t>& inside) {
+  size_t i = 0;
+
+  for(; i + 4 <= boxes.count; i += 4) {
+    int mask = 0xF;
+
+    for(size_t p = 0; p < planes.size() && mask; ++p) {
+      __m128 d = distanceWide(planes[p], _mm_loadu_ps(corners[p].xs + i), _mm_loadu_ps(corners[p].ys + i), _mm_loadu_ps(corners[p].zs + i));
+      mask &= _mm_movemask_ps(_mm_cmpge_ps(d, _mm_setzero_ps()));
+    }
+
+    pushLanes(static_cast<uint32_t>(mask), i, inside);
+  }
+
+  return i;
+}
+
+size_t spheresWide(std::span<const calc::Vec4> planes, const Spheres& spheres, std::vector<uint32_t>& inside) {
+  size_t i = 0;
+
+  for(; i + 4 <= spheres.count; i += 4) {
+    __m128 x = _mm_loadu_ps(spheres.xs + i), y = _mm_loadu_ps(spheres.ys + i), z = _mm_loadu_ps(spheres.zs + i);
+    __m128 negativeRadii = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radii + i));
+    int mask = 0xF;
+
+    for(size_t p = 0; p < planes.size() && mask; ++p) {
+      mask &= _mm_movemask_ps(_mm_cmpge_ps(distanceWide(planes[p], x, y, z), negativeRadii));
+    }
+
+    pushLanes(static_cast<uint32_t>(mask), i, inside);
+  }
+
+  return i;
+}
+#elif defined(BATCH_NEON)
+// Separate multiply and add, a fused one would round differently from the scalar path
+inline float32x4_t distanceWide(const calc::Vec4& plane, float32x4_t x, float32x4_t y, float32x4_t z) {
+  float32x4_t d = vaddq_f32(vmulq_n_f32(x, plane.x), vmulq_n_f32(y, plane.y));
+  return vaddq_f32(vaddq_f32(d, vmulq_n_f32(z, plane.z)), vdupq_n_f32(plane.w));
+}
+
+inline uint32_t laneMask(uint32x4_t lanes) {
+  return (vgetq_lane_u32(lanes, 0) & 1) | (vgetq_lane_u32(lanes, 1) & 2) | (vgetq_lane_u32(lanes, 2) & 4) | (vgetq_lane_u32(lanes, 3) & 8);
+}
+
+size_t transformWide(const calc::Mat4& m, const Points& points, float* outX, float* outY, float* outZ) {
+  size_t i = 0;
+
+  for(; i + 4 <= points.count; i += 4) {
+    float32x4_t x = vld1q_f32(points.xs + i), y = vld1q_f32(points.ys + i), z = vld1q_f32(points.zs + i);
+    vst1q_f32(outX + i, distanceWide({m[0], m[4], m[8], m[12]}, x, y, z));
+    vst1q_f32(outY + i, distanceWide({m[1], m[5], m[9], m[13]}, x, y, z));
+    vst1q_f32(outZ + i, distanceWide({m[2], m[6], m[10], m[14]}, x, y, z));
+  }
+
+  return i;
+}
+
+size_t boxesWide(std::span<const calc::Vec4> planes, std::span<const PlaneCorner> corners, const Boxes& boxes, std::vector<uint32_t>& inside) {
+  size_t i = 0;
+
+  for(; i + 4 <= boxes.count; i += 4) {
+    uint32x4_t visible = vdupq_n_u32(0xFFFFFFFF);
+
+    for(size_t p = 0; p < planes.size(); ++p) {
+      float32x4_t d = distanceWide(planes[p], vld1q_f32(corners[p].xs + i), vld1q_f32(corners[p].ys + i), vld1q_f32(corners[p].zs + i));
+      visible = vandq_u32(visible, vcgeq_f32(d, vdupq_n_f32(0.0f)));
+    }
+
+    pushLanes(laneMask(visible), i, inside);
+  }
+
+  return i;
+}
+
+size_t spheresWide(std::span<const calc::Vec4> planes, const Spheres& spheres, std::vector<uint32_t>& inside) {
+  size_t i = 0;
+
+  for(; i + 4 <= spheres.count; i += 4) {
+    float32x4_t x = vld1q_f32(spheres.xs + i), y = vld1q_f32(spheres.ys + i), z = vld1q_f32(spheres.zs + i);
+    float32x4_t negativeRadii = vnegq_f32(vld1q_f32(spheres.radii + i));
+    uint32x4_t visible = vdupq_n_u32(0xFFFFFFFF);
+
+    for(size_t p = 0; p < planes.size(); ++p) {
+      visible = vandq_u32(visible, vcgeq_f32(distanceWide(planes[p], x, y, z), negativeRadii));
+    }
+
+    pushLanes(laneMask(visible), i, inside);
+  }
+
+  return i;
+}
+#else
+size_t transformWide(const calc::Mat4&, const Points&, float*, float*, float*) {
+  return 0;
+}
+
+size_t boxesWide(std::span<const calc::Vec4>, std::span<const PlaneCorner>, const Boxes&, std::vector<uint32_t>&) {
+  return 0;
+}
+
+size_t spheresWide(std::span<const calc::Vec4>, const Spheres&, std::vector<uint32_t>&) {
+  return 0;
+}
+#endif
+
+#ifdef BATCH_AVX2
+AVX2_TARGET inline __m256 distanceAvx2(const calc::Vec4& plane, __m256 x, __m256 y, __m256 z) {
+  __m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), x), _mm256_mul_ps(_mm256_set1_ps(plane.y), y));
+  return _mm256_add_ps(_mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(plane.z), z)), _mm256_set1_ps(plane.w));
+}
+
+AVX2_TARGET size_t transformAvx2(const calc::Mat4& m, const Points& points, float* outX, float* outY, float* outZ) {
+  size_t i = 0;
+
+  for(; i + 8 <= points.count; i += 8) {
+    __m256 x = _mm256_loadu_ps(points.xs + i), y = _mm256_loadu_ps(points.ys + i), z = _mm256_loadu_ps(points.zs + i);
+    _mm256_storeu_ps(outX + i, distanceAvx2({m[0], m[4], m[8], m[12]}, x, y, z));
+    _mm256_storeu_ps(outY + i, distanceAvx2({m[1], m[5], m[9], m[13]}, x, y, z));
+    _mm256_storeu_ps(outZ + i, distanceAvx2({m[2], m[6], m[10], m[14]}, x, y, z));
+  }
+
+  return i;
+}
+
+AVX2_TARGET size_t boxesAvx2(std::span<const calc::Vec4> planes, std::span<const PlaneCorner> corners, const Boxes& boxes, std::vector<uint32_t>& inside) {
+  size_t i = 0;
+
+  for(; i + 8 <= boxes.count; i += 8) {
+    int mask = 0xFF;
+
+    for(size_t p = 0; p < planes.size() && mask; ++p) {
+      __m256 d = distanceAvx2(planes[p], _mm256_loadu_ps(corners[p].xs + i), _mm256_loadu_ps(corners[p].ys + i), _mm256_loadu_ps(corners[p].zs + i));
+      mask &= _mm256_movemask_ps(_mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+
+    pushLanes(static_cast<uint32_t>(mask), i, inside);
+  }
+
+  return i;
+}
+
+AVX2_TARGET size_t spheresAvx2(std::span<const calc::Vec4> planes, const Spheres& spheres, std::vector<uint32_t>& inside) {
+  size_t i = 0;
+
+  for(; i + 8 <= spheres.count; i += 8) {
+    __m256 x = _mm256_loadu_ps(spheres.xs + i), y = _mm256_loadu_ps(spheres.ys + i), z = _mm256_loadu_ps(spheres.zs + i);
+    __m256 negativeRadii = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radii + i));
+    int mask = 0xFF;
+
+    for(size_t p = 0; p < planes.size() && mask; ++p) {
+      mask &= _mm256_movemask_ps(_mm256_cmp_ps(distanceAvx2(planes[p], x, y, z), negativeRadii, _CMP_GE_OQ));
+    }
+
+    pushLanes(static_cast<uint32_t>(mask), i, inside);
+  }
+
+  return i;
+}
+#else
+size_t transformAvx2(const calc::Mat4& m, const Points& points, float* outX, float* outY, float* outZ) {
+  return transformWide(m, points, outX, outY, outZ);
+}
+
+size_t boxesAvx2(std::span<const calc::Vec4> planes, std::span<const PlaneCorner> corners, const Boxes& boxes, std::vector<uint32_t>& inside) {
+  return boxesWide(planes, corners, boxes, inside);
+}
+
+size_t spheresAvx2(std::span<const calc::Vec4> planes, const Spheres& spheres, std::vector<uint32_t>& inside) {
+  return spheresWide(planes, spheres, inside);
+}
+#endif
+
+void transformPoints(const calc::Mat4& matrix, const Points& points, float* outX, float* outY, float* outZ, Path path) {
+  size_t i = 0;
+
+  if(path == Path::Avx2) {
+    i = transformAvx2(matrix, points, outX, outY, outZ);
+  } else if(path == Path::Wide) {
+    i = transformWide(matrix, points, outX, outY, outZ);
+  }
+
+  transformScalar(matrix, points, outX, outY, outZ, i);
+}
+
+size_t boxesInside(std::span<const calc::Vec4> planes, const Boxes& boxes, std::vector<uint32_t>& inside, Path path) {
+  std::array<PlaneCorner, cornerSlots> slots;
+  std::vector<PlaneCorner> overflow;
+  std::span<PlaneCorner> corners(slots.data(), std::min(planes.size(), slots.size()));
+  if(planes.size() > slots.size()) {
+    overflow.resize(planes.size());
+    corners = overflow;
+  }
+
+  furthestCorners(planes, boxes, corners);
+  size_t i = 0;
+
+  inside.clear();
+  inside.reserve(boxes.count);
+
+  if(path == Path::Avx2) {
+    i = boxesAvx2(planes, corners, boxes, inside);
+  } else if(path == Path::Wide) {
+    i = boxesWide(planes, corners, boxes, inside);
+  }
+
+  boxesScalar(planes, corners, boxes, inside, i);
+  return inside.size();
+}
+
+size_t spheresInside(std::span<const calc::Vec4> planes, const Spheres& spheres, std::vector<uint32_t>& inside, Path path) {
+  size_t i = 0;
+
+  inside.clear();
+  inside.reserve(spheres.count);
+
+  if(path == Path::Avx2) {
+    i = spheresAvx2(planes, spheres, inside);
+  } else if(path == Path::Wide) {
+    i = spheresWide(planes, spheres, inside);
+  }
+
+  spheresScalar(planes, spheres, inside, i);
+  return inside.size();
+}
+} // namespace batch
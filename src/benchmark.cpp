@@ -0,0 +1,1403 @@
+#include "../include/benchmark.hpp"
+
+#include "../include/assetPack.hpp"
+#include "../include/batch.hpp"
+#include "../include/collision.hpp"
+#include "../include/culling.hpp"
+#include "../include/fileHandler.hpp"
+#include "../include/game.hpp"
+#include "../include/nullRenderer.hpp"
+#include "../include/player.hpp"
+#include "../include/renderer.hpp"
+#include "../include/taskGraph.hpp"
+#include "../include/terrain.hpp"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <print>
+#include <span>
+#include <unordered_map>
+#include <SDL3/SDL_surface.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace benchmark {
+using Clock = std::chrono::steady_clock;
+
+constexpr float aspect = 800.0f / 600.0f;
+
+// GPU results trail the CPU by the frames in flight, until then they belong to whatever was drawn before
+bool gpuWarmedUp(int frame) {
+  return frame >= MAX_FRAMES_IN_FLIGHT;
+}
+
+struct CameraPath {
+  std::string name;
+  int steps;
+  std::function<void(Player&, float)> move;
+};
+
+// t goes from 0 to 1 along the path
+const std::vector<CameraPath> cameraPaths = {
+  {"orbit", 360, [](Player& p, float t) {
+    p.x = 64.0f; p.y = 20.0f; p.z = 64.0f;
+    p.mouseX = t * 360.0f; p.mouseY = -10.0f;
+  }},
+  {"flyover", 256, [](Player& p, float t) {
+    p.x = -16.0f + t * 160.0f; p.y = 40.0f; p.z = 64.0f;
+    p.mouseX = -90.0f; p.mouseY = -45.0f;
+  }},
+  {"walk", 256, [](Player& p, float t) {
+    p.x = 8.0f; p.y = 17.0f; p.z = 120.0f - t * 112.0f;
+    p.mouseX = 0.0f; p.mouseY = 0.0f;
+  }},
+  {"look down", 90, [](Player& p, float t) {
+    p.x = 64.0f; p.y = 30.0f; p.z = 64.0f;
+    p.mouseX = 0.0f; p.mouseY = -t * 90.0f;
+  }},
+  {"underground", 256, [](Player& p, float t) {
+    p.x = 8.0f + t * 112.0f; p.y = 2.5f; p.z = 64.0f;
+    p.mouseX = -90.0f; p.mouseY = 0.0f;
+  }}
+};
+
+std::array<calc::Vec4, 6> planesFor(const Player& player) {
+  return (player.projection(aspect) * player.rotation() * player.translation()).frustumPlanes();
+}
+
+double chunksPerMicrosecond(const culling::ChunkBounds& bounds, const std::array<calc::Vec4, 6>& planes, bool simd, size_t& visibleCount) {
+  std::vector<uint32_t> visible;
+  int iterations = 0;
+  Clock::time_point start = Clock::now(), end;
+
+  do {
+    visibleCount = simd ? culling::cullChunks(bounds, planes, visible) : culling::cullChunksScalar(bounds, planes, visible);
+    ++iterations;
+    end = Clock::now();
+  } while(end - start < std::chrono::milliseconds(250));
+
+  double us = std::chrono::duration<double, std::micro>(end - start).count();
+  return static_cast<double>(bounds.size()) * iterations / us;
+}
+
+// Two layers of air under a solid one, one air chunk opens only between its x faces and is reached first through z.
+// The chunk behind it and the one under that have to come out reachable, nothing under the solid layer may
+bool stackedGraph() {
+  const visibility::Connectivity open = (visibility::Connectivity(1) << 36) - 1;
+  auto link = [](visibility::Face a, visibility::Face b) {
+    return visibility::Connectivity(1) << (a * 6 + b) | visibility::Connectivity(1) << (b * 6 + a);
+  };
+  const visibility::Connectivity tunnel = link(visibility::NegativeX, visibility::PositiveX) | link(visibility::NegativeX, visibility::NegativeX) | link(visibility::PositiveX, visibility::PositiveX);
+
+  std::vector<Chunk> chunks;
+  std::vector<visibility::Connectivity> connectivity;
+  for(int x = 0; x < 3; ++x) {
+    for(int y = -2; y <= 0; ++y) {
+      for(int z = 0; z < 2; ++z) {
+        Chunk chunk;
+        chunk.x = x * 16;
+        chunk.y = y * 16;
+        chunk.z = z * 16;
+        chunks.push_back(chunk);
+
+        bool solid = y == -1 || (x == 2 && y == 0 && z == 0);
+        connectivity.push_back(solid ? 0 : x == 1 && y == 0 && z == 1 ? tunnel : open);
+      }
+    }
+  }
+
+  visibility::ChunkGraph graph;
+  graph.build(chunks, connectivity);
+
+  const std::vector<std::array<int, 3>> expected = {
+    {0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {0, 0, 1}, {1, 0, 1}, {2, 0, 1},
+    {0, -1, 0}, {1, -1, 0}, {0, -1, 1}, {2, -1, 1},
+  };
+
+  std::vector<uint8_t> reachable;
+  graph.potentiallyVisible(8.0f, 8.0f, 8.0f, reachable);
+
+  bool matches = true;
+  for(size_t i = 0; i < chunks.size(); ++i) {
+    std::array<int, 3> position = {chunks[i].x >> 4, chunks[i].y >> 4, chunks[i].z >> 4};
+    matches = matches && (reachable[i] != 0) == (std::ranges::find(expected, position) != expected.end());
+  }
+
+  return matches;
+}
+
+int frustumCulling() {
+  if(!stackedGraph()) {
+    std::print("!!!Cave culling of the stacked synthetic graph does not match the expected chunks\n");
+    return 1;
+  }
+
+  Terrain terrain;
+  std::vector<uint32_t> visible, reference;
+  std::vector<uint8_t> reachable;
+  Player player(0.0f, 0.0f, 0.0f);
+
+  std::print("==== visible chunks ({} total) ====\n", terrain.bounds.size());
+  for(const CameraPath& path : cameraPaths) {
+    size_t minimum = terrain.bounds.size(), maximum = 0, sum = 0, caveSum = 0;
+
+    for(int i = 0; i < path.steps; ++i) {
+      path.move(player, static_cast<float>(i) / (path.steps - 1));
+      std::array<calc::Vec4, 6> planes = planesFor(player);
+
+      size_t count = culling::cullChunks(terrain.bounds, planes, visible);
+      culling::cullChunksScalar(terrain.bounds, planes, reference);
+
+      if(visible != reference) {
+        std::print("!!!SIMD and scalar culling disagree on path {} step {}\n", path.name, i);
+        return 1;
+      }
+
+      terrain.graph.potentiallyVisible(player.x, player.y, player.z, reachable);
+      for(uint32_t chunk : visible) {
+        caveSum += reachable[chunk];
+      }
+
+      minimum = std::min(minimum, count);
+      maximum = std::max(maximum, count);
+      sum += count;
+    }
+
+    std::print("{:>11}: min {:>4} avg {:>7.1f} max {:>4}, after cave culling avg {:>7.1f}\n", path.name, minimum, static_cast<double>(sum) / path.steps, maximum, static_cast<double>(caveSum) / path.steps);
+  }
+
+  // Large synthetic world so the timing is not dominated by loop overhead
+  culling::ChunkBounds world;
+  for(int x = -64; x < 64; ++x) {
+    for(int y = 0; y < 8; ++y) {
+      for(int z = -64; z < 64; ++z) {
+        world.push(x * 16.0f, y * 16.0f, z * 16.0f, x * 16.0f + 16.0f, y * 16.0f + 16.0f, z * 16.0f + 16.0f);
+      }
+    }
+  }
+
+  cameraPaths.front().move(player, 0.125f);
+  std::array<calc::Vec4, 6> planes = planesFor(player);
+  size_t simdVisible = 0, scalarVisible = 0;
+  double simd = chunksPerMicrosecond(world, planes, true, simdVisible);
+  double scalar = chunksPerMicrosecond(world, planes, false, scalarVisible);
+
+  std::print("==== throughput ({} chunks, {} visible) ====\n", world.size(), simdVisible);
+  std::print("       simd: {:>8.1f} chunks/us\n", simd);
+  std::print("     scalar: {:>8.1f} chunks/us\n", scalar);
+
+  return simdVisible == scalarVisible ? 0 : 1;
+}
+
+// Every other chunk is released and uploaded again, culling has to match on both sides and the late frees have to drain
+int releaseCycle(Renderer& renderer, Terrain& terrain, Player& player) {
+  cameraPaths.front().move(player, 0.125f);
+  int failures = 0;
+  uint32_t released = 0;
+
+  auto settle = [&]() {
+    renderer.drawFrame(&player, terrain);
+    failures += !renderer.verifyGpuCulling(terrain);
+
+    // A frame retires what was tagged with it once its slot comes around again
+    for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      renderer.drawFrame(&player, terrain);
+    }
+
+    failures += renderer.pendingDeletions() > 0;
+    return renderer.pendingDeletions();
+  };
+
+  for(uint32_t chunk = 0; chunk < terrain.meshes.size(); chunk += 2) {
+    released += terrain.meshes[chunk].uploaded;
+    renderer.releaseChunkMesh(terrain, chunk);
+  }
+
+  size_t afterRelease = settle();
+  renderer.uploadTerrain(terrain);
+  size_t afterUpload = settle();
+
+  std::print("{:>11}: {} chunks released and uploaded again, {} and {} deletions left\n", "release", released, afterRelease, afterUpload);
+  if(failures > 0) {
+    std::print("!!!Culling differs or deletions did not drain after a release\n");
+  }
+
+  return failures;
+}
+
+// Needs a Vulkan device, on CI that is lavapipe under a virtual display
+int gpuCulling() {
+  if(!SDL_Init(SDL_INIT_VIDEO)) {
+    std::print("!!!Could not init SDL: {}\n", SDL_GetError());
+    return 1;
+  }
+
+  SDL_Window* window = SDL_CreateWindow("MineCloneCraft", 800, 600, SDL_WINDOW_VULKAN);
+  if(!window) {
+    std::print("!!!Could not create window: {}\n", SDL_GetError());
+    SDL_Quit();
+    return 1;
+  }
+
+  int failures = 0;
+  {
+    Renderer renderer(window);
+
+    if(!renderer.hasGpuCulling()) {
+      std::print("!!!Device has no drawIndirectCount, nothing to verify\n");
+      failures = 1;
+    } else {
+      Terrain terrain;
+      renderer.uploadTerrain(terrain);
+      Player player(0.0f, 0.0f, 0.0f);
+
+      std::print("==== gpu culling against cpu ====\n");
+      for(const CameraPath& path : cameraPaths) {
+        int matching = 0;
+
+        for(int i = 0; i < path.steps; ++i) {
+          path.move(player, static_cast<float>(i) / (path.steps - 1));
+          renderer.drawFrame(&player, terrain);
+
+          if(renderer.verifyGpuCulling(terrain)) {
+            ++matching;
+          } else {
+            ++failures;
+          }
+        }
+
+        std::print("{:>11}: {:>4} / {:>4} frames match\n", path.name, matching, path.steps);
+      }
+
+      failures += releaseCycle(renderer, terrain, player);
+    }
+  }
+
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return failures == 0 ? 0 : 1;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+  if(sorted.empty()) {
+    return 0.0;
+  }
+
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+void printTimes(const std::string& label, std::vector<double> times) {
+  std::sort(times.begin(), times.end());
+  std::print("{:>11}: p50 {:>7.3f} p95 {:>7.3f} p99 {:>7.3f} max {:>7.3f} ms\n", label, percentile(times, 0.5), percentile(times, 0.95), percentile(times, 0.99), times.empty() ? 0.0 : times.back());
+}
+
+// FNV-1a, enough to notice a single changed pixel between runs
+uint64_t hashPixels(const std::vector<uint8_t>& pixels, uint64_t hash = 14695981039346656037ull) {
+  for(uint8_t byte : pixels) {
+    hash = (hash ^ byte) * 1099511628211ull;
+  }
+
+  return hash;
+}
+
+bool savePNG(const std::string& path, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+  SDL_Surface* surface = SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_RGBA32, const_cast<uint8_t*>(pixels.data()), width * 4);
+  bool saved = surface && SDL_SavePNG(surface, path.c_str());
+
+  if(!saved) {
+    std::print("!!!Could not save {}: {}\n", path, SDL_GetError());
+  }
+
+  SDL_DestroySurface(surface);
+  return saved;
+}
+
+struct OverdrawSetting {
+  std::string name;
+  bool sorted;
+  bool prepass;
+};
+
+// Fragment shader invocations per frame show how much shading the ordering saves.
+// The compute cull compacts draws in whatever order its atomics give, so the renderer has to cull on the CPU for the sort to mean anything
+int overdraw(Renderer& renderer, Terrain& terrain) {
+  const std::vector<OverdrawSetting> settings = {
+    {"unsorted", false, false},
+    {"sorted", true, false},
+    {"pre-pass", true, true},
+  };
+
+  if(!renderer.hasPipelineStatistics()) {
+    std::print("!!!Pipeline statistics unavailable, fragment invocations can not be counted\n");
+    return 1;
+  }
+
+  if(renderer.hasGpuCulling()) {
+    std::print("!!!Chunks are culled in a compute pass, sorted and unsorted would draw in the same order\n");
+    return 1;
+  }
+
+  Player player(0.0f, 0.0f, 0.0f);
+
+  std::print("==== overdraw (cpu culling) ====\n");
+  for(const OverdrawSetting& setting : settings) {
+    renderer.setChunkSorting(setting.sorted);
+    renderer.setDepthPrepass(setting.prepass);
+
+    for(const CameraPath& path : cameraPaths) {
+      std::vector<double> gpu;
+      double fragments = 0.0;
+
+      for(int i = 0; i < path.steps; ++i) {
+        path.move(player, static_cast<float>(i) / (path.steps - 1));
+        renderer.drawFrame(&player, terrain);
+
+        // Same as the timings, the first results still belong to the previous path
+        if(gpuWarmedUp(i)) {
+          gpu.push_back(renderer.lastGpuTimeMs());
+          fragments += renderer.lastFragmentInvocations();
+        }
+      }
+
+      std::sort(gpu.begin(), gpu.end());
+      std::print("{:>9} {:>11}: {:>12.0f} fragments/frame, gpu p50 {:.3f} ms\n", setting.name, path.name, fragments / gpu.size(), gpu[gpu.size() / 2]);
+    }
+  }
+
+  return 0;
+}
+
+// Runs on any Vulkan device without a display, lavapipe included
+int headless(const std::vector<std::string>& args) {
+  bool hash = false;
+  bool measureOverdraw = false;
+  std::string pngDir;
+
+  for(const std::string& arg : args) {
+    if(arg == "--hash") {
+      hash = true;
+    } else if(arg == "--overdraw") {
+      measureOverdraw = true;
+    } else if(arg.starts_with("--png-dir=")) {
+      pngDir = arg.substr(10);
+    }
+  }
+
+  Renderer renderer(800, 600, assetPack::defaultPath(), !measureOverdraw);
+  Terrain terrain;
+  renderer.uploadTerrain(terrain);
+
+  if(measureOverdraw) {
+    return overdraw(renderer, terrain);
+  }
+
+  Player player(0.0f, 0.0f, 0.0f);
+
+  std::vector<uint8_t> pixels;
+  uint32_t width = 0, height = 0;
+  std::vector<double> allCpu, allGpu;
+
+  std::print("==== headless fly-through ====\n");
+  for(const CameraPath& path : cameraPaths) {
+    std::vector<double> cpu, gpu;
+    uint64_t pathHash = 14695981039346656037ull;
+
+    for(int i = 0; i < path.steps; ++i) {
+      path.move(player, static_cast<float>(i) / (path.steps - 1));
+
+      Clock::time_point start = Clock::now();
+      renderer.drawFrame(&player, terrain);
+      cpu.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+      if(gpuWarmedUp(i)) {
+        gpu.push_back(renderer.lastGpuTimeMs());
+      }
+
+      // Reading back waits for the GPU, so hashing runs change the timings
+      if(hash && renderer.readFrame(pixels, width, height)) {
+        pathHash = hashPixels(pixels, pathHash);
+      }
+    }
+
+    printTimes(path.name + " cpu", cpu);
+    printTimes(path.name + " gpu", gpu);
+
+    if(hash) {
+      std::print("{:>11}: frames hash {:016x}\n", path.name, pathHash);
+    }
+
+    std::print("{}", renderer.gpuReport());
+
+    if(!pngDir.empty() && renderer.readFrame(pixels, width, height)) {
+      std::string name = path.name;
+      std::replace(name.begin(), name.end(), ' ', '_');
+      savePNG(pngDir + "/" + name + ".png", pixels, width, height);
+    }
+
+    allCpu.insert(allCpu.end(), cpu.begin(), cpu.end());
+    allGpu.insert(allGpu.end(), gpu.begin(), gpu.end());
+  }
+
+  std::print("==== all paths ====\n");
+  printTimes("cpu", allCpu);
+  printTimes("gpu", allGpu);
+  return 0;
+}
+
+// The kernels calc had before it went header only, both the reference and the baseline
+namespace naive {
+calc::Mat4 multiply(const calc::Mat4& a, const calc::Mat4& b) {
+  calc::Mat4 result(0.0f);
+
+  for(int i = 0; i < 4; ++i) {
+    for(int j = 0; j < 4; ++j) {
+      for(int k = 0; k < 4; ++k) {
+        result(i, j) += a(i, k) * b(k, j);
+      }
+    }
+  }
+
+  return result;
+}
+
+calc::Vec4 transform(const calc::Mat4& a, const calc::Vec4& v) {
+  calc::Vec4 result(0.0f);
+
+  for(int i = 0; i < 4; ++i) {
+    for(int j = 0; j < 4; ++j) {
+      result[i] += a(i, j) * v[j];
+    }
+  }
+
+  return result;
+}
+
+std::array<calc::Vec4, 6> frustumPlanes(const calc::Mat4& m) {
+  calc::Vec4 rows[4];
+
+  for(int i = 0; i < 4; ++i) {
+    rows[i] = {m(i, 0), m(i, 1), m(i, 2), m(i, 3)};
+  }
+
+  std::array<calc::Vec4, 6> planes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2]};
+
+  for(calc::Vec4& plane : planes) {
+    float mag = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+    if(mag > 1e-6f) {
+      plane = {plane.x / mag, plane.y / mag, plane.z / mag, plane.w / mag};
+    }
+  }
+
+  return planes;
+}
+} // namespace naive
+
+// Calls per microsecond over a batch, the checksum keeps the compiler from dropping the work
+template <typename F> double callsPerMicrosecond(size_t count, F&& call) {
+  float checksum = 0.0f;
+  size_t calls = 0;
+  Clock::time_point start = Clock::now(), end;
+
+  do {
+    for(size_t i = 0; i < count; ++i) {
+      checksum += call(i);
+    }
+    calls += count;
+    end = Clock::now();
+  } while(end - start < std::chrono::milliseconds(250));
+
+  volatile float sink = checksum;
+  (void) sink;
+  return calls / std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+void printSpeedup(const std::string& label, double before, double after) {
+  std::print("{:>15}: naive {:>8.1f} calls/us, simd {:>8.1f} calls/us, {:.2f}x\n", label, before, after, after / before);
+}
+
+// SIMD lanes against the scalar ones, bit for bit, on random, projection and degenerate matrices
+size_t laneMismatches(const std::vector<calc::Mat4>& matrices, const std::vector<calc::Vec4>& vectors) {
+  using Scalar = calc::lanes::Scalar;
+  using Simd = calc::lanes::Simd;
+
+  std::vector<calc::Mat4> inputs = matrices;
+  for(float fov : {0.5f, 1.2f, 2.0f}) {
+    inputs.push_back(calc::Mat4::perspective(fov, 16.0f / 9.0f, 0.1f, 1000.0f));
+    inputs.push_back(calc::Mat4::perspective(fov, 16.0f / 9.0f, 0.1f, 1000.0f) * calc::Mat4::MRotationY(fov) * calc::Mat4::MRotationX(fov));
+  }
+  // Zero rows give planes too short to normalize, so the replacement lanes of above() are read too
+  inputs.push_back(calc::Mat4(0.0f));
+  inputs.push_back(calc::Mat4(1.0f));
+
+  size_t mismatches = 0;
+  for(size_t i = 0; i < inputs.size(); ++i) {
+    const calc::Mat4& a = inputs[i];
+    const calc::Mat4& b = inputs[(i + 1) % inputs.size()];
+    const calc::Vec4& v = vectors[i % vectors.size()];
+
+    mismatches += calc::Mat4::multiply<Simd>(a, b) != calc::Mat4::multiply<Scalar>(a, b);
+    mismatches += !(calc::Mat4::transform<Simd>(a, v) == calc::Mat4::transform<Scalar>(a, v));
+    mismatches += calc::Mat4::frustumPlanes<Simd>(a) != calc::Mat4::frustumPlanes<Scalar>(a);
+    // Singular inputs give infinities and NaNs, compared as bits so those have to match as well
+    calc::Mat4 simd = calc::Mat4::inverse<Simd>(a), scalar = calc::Mat4::inverse<Scalar>(a);
+    mismatches += std::memcmp(simd.array.data(), scalar.array.data(), sizeof(simd.array)) != 0;
+  }
+
+  return mismatches;
+}
+
+// Every kernel against the naive ones and against its own scalar lanes on random matrices, then the timings
+int math(const std::vector<std::string>& args) {
+  std::mt19937 rng(67);
+  std::uniform_real_distribution<float> value(-4.0f, 4.0f);
+
+  const size_t count = 4096;
+  std::vector<calc::Mat4> matrices(count);
+  std::vector<calc::Vec4> vectors(count);
+
+  for(size_t i = 0; i < count; ++i) {
+    for(float& element : matrices[i].array) {
+      element = value(rng);
+    }
+    vectors[i] = {value(rng), value(rng), value(rng), value(rng)};
+  }
+
+  size_t mismatches = 0, inaccurate = 0;
+  for(size_t i = 0; i < count; ++i) {
+    const calc::Mat4& a = matrices[i];
+    const calc::Mat4& b = matrices[(i + 1) % count];
+
+    // Same order of operations in every path, so the results have to be identical
+    mismatches += a * b != naive::multiply(a, b) || calc::Mat4::multiply<calc::lanes::Scalar>(a, b) != a * b;
+    mismatches += !(a * vectors[i] == naive::transform(a, vectors[i])) || !(calc::Mat4::transform<calc::lanes::Scalar>(a, vectors[i]) == a * vectors[i]);
+    mismatches += a.frustumPlanes() != naive::frustumPlanes(a) || calc::Mat4::frustumPlanes<calc::lanes::Scalar>(a) != a.frustumPlanes();
+    mismatches += a.inverse() != calc::Mat4::inverse<calc::lanes::Scalar>(a);
+
+    // Random matrices can be badly conditioned, so only the error relative to the inverse's size counts
+    calc::Mat4 inverse = a.inverse();
+    calc::Mat4 identity = a * inverse;
+    float size = 0.0f, error = 0.0f;
+    for(int j = 0; j < 16; ++j) {
+      size = std::max(size, std::abs(inverse[j]));
+      error = std::max(error, std::abs(identity[j] - calc::Mat4()[j]));
+    }
+    inaccurate += error > 1e-4f * std::max(size, 1.0f);
+  }
+
+  size_t lanes = laneMismatches(matrices, vectors);
+
+  std::print("==== calc kernels ({} random matrices) ====\n", count);
+  if(mismatches > 0 || inaccurate > 0) {
+    std::print("!!!{} results differ from the naive kernels, {} inverses are inaccurate\n", mismatches, inaccurate);
+  }
+  if(lanes > 0) {
+    std::print("!!!{} SIMD results differ from the scalar lanes\n", lanes);
+  }
+
+  bool passed = mismatches == 0 && inaccurate == 0 && lanes == 0;
+  if(std::ranges::find(args, "--check") != args.end()) {
+    std::print("{}\n", passed ? "SIMD and scalar lanes agree" : "!!!calc check failed");
+    return passed ? 0 : 1;
+  }
+
+  printSpeedup("mat4 * mat4",
+    callsPerMicrosecond(count, [&](size_t i) { return naive::multiply(matrices[i], matrices[(i + 1) % count])[5]; }),
+    callsPerMicrosecond(count, [&](size_t i) { return (matrices[i] * matrices[(i + 1) % count])[5]; }));
+  printSpeedup("mat4 * vec4",
+    callsPerMicrosecond(count, [&](size_t i) { return naive::transform(matrices[i], vectors[i]).y; }),
+    callsPerMicrosecond(count, [&](size_t i) { return (matrices[i] * vectors[i]).y; }));
+  printSpeedup("frustum planes",
+    callsPerMicrosecond(count, [&](size_t i) { return naive::frustumPlanes(matrices[i])[3].w; }),
+    callsPerMicrosecond(count, [&](size_t i) { return matrices[i].frustumPlanes()[3].w; }));
+  printSpeedup("inverse",
+    callsPerMicrosecond(count, [&](size_t i) { return calc::Mat4::inverse<calc::lanes::Scalar>(matrices[i])[5]; }),
+    callsPerMicrosecond(count, [&](size_t i) { return matrices[i].inverse()[5]; }));
+
+  return passed ? 0 : 1;
+}
+
+// Best of a few runs in milliseconds
+template <typename F> double bestMs(int runs, F&& call) {
+  double best = 1e30;
+
+  for(int run = 0; run < runs; ++run) {
+    Clock::time_point start = Clock::now();
+    call();
+    best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+  }
+
+  return best;
+}
+
+// Milliseconds per million elements, the best of a few runs
+template <typename F> double msPerMillion(size_t count, F&& call) {
+  return bestMs(5, call) * 1e6 / count;
+}
+
+// A million random points, boxes and spheres around the camera of the orbit path, every path has to agree with the scalar one
+int batchKernels() {
+  const size_t count = 1 << 20;
+  std::mt19937 rng(67);
+  std::uniform_real_distribution<float> position(-256.0f, 256.0f), extent(0.5f, 16.0f);
+
+  std::vector<float> xs(count), ys(count), zs(count), sizes(count);
+  std::vector<float> maxX(count), maxY(count), maxZ(count);
+  for(size_t i = 0; i < count; ++i) {
+    xs[i] = position(rng);
+    ys[i] = position(rng);
+    zs[i] = position(rng);
+    sizes[i] = extent(rng);
+    maxX[i] = xs[i] + sizes[i];
+    maxY[i] = ys[i] + sizes[i];
+    maxZ[i] = zs[i] + sizes[i];
+  }
+
+  Player player(0.0f, 0.0f, 0.0f);
+  cameraPaths.front().move(player, 0.125f);
+  calc::Mat4 viewProj = player.projection(aspect) * player.rotation() * player.translation();
+  std::array<calc::Vec4, 6> planes = viewProj.frustumPlanes();
+
+  batch::Points points{xs.data(), ys.data(), zs.data(), count};
+  batch::Boxes boxes{xs.data(), ys.data(), zs.data(), maxX.data(), maxY.data(), maxZ.data(), count};
+  batch::Spheres spheres{xs.data(), ys.data(), zs.data(), sizes.data(), count};
+
+  std::vector<float> outX(count), outY(count), outZ(count);
+  std::vector<float> referenceX(count), referenceY(count), referenceZ(count);
+  std::vector<uint32_t> inside, referenceBoxes, referenceSpheres;
+
+  batch::transformPoints(viewProj, points, referenceX.data(), referenceY.data(), referenceZ.data(), batch::Path::Scalar);
+  batch::boxesInside(planes, boxes, referenceBoxes, batch::Path::Scalar);
+  batch::spheresInside(planes, spheres, referenceSpheres, batch::Path::Scalar);
+
+  std::vector<batch::Path> paths = {batch::Path::Scalar, batch::Path::Wide};
+  if(batch::bestPath() == batch::Path::Avx2) {
+    paths.push_back(batch::Path::Avx2);
+  }
+
+  int failures = 0;
+  std::print("==== batch kernels ({} elements, {} boxes and {} spheres inside) ====\n", count, referenceBoxes.size(), referenceSpheres.size());
+  for(batch::Path path : paths) {
+    double transform = msPerMillion(count, [&]() { batch::transformPoints(viewProj, points, outX.data(), outY.data(), outZ.data(), path); });
+    bool same = std::memcmp(outX.data(), referenceX.data(), count * sizeof(float)) == 0
+      && std::memcmp(outY.data(), referenceY.data(), count * sizeof(float)) == 0
+      && std::memcmp(outZ.data(), referenceZ.data(), count * sizeof(float)) == 0;
+
+    double box = msPerMillion(count, [&]() { batch::boxesInside(planes, boxes, inside, path); });
+    same = same && inside == referenceBoxes;
+
+    double sphere = msPerMillion(count, [&]() { batch::spheresInside(planes, spheres, inside, path); });
+    same = same && inside == referenceSpheres;
+
+    std::print("{:>11}: transform {:>7.3f} boxes {:>7.3f} spheres {:>7.3f} ms per million\n", batch::name(path), transform, box, sphere);
+
+    if(!same) {
+      std::print("!!!{} results differ from the scalar path\n", batch::name(path));
+      ++failures;
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+// A cube of cubes over the terrain, the same volume at any count so they all stay in view of the orbit
+std::vector<ModelInstance> instanceGrid(size_t count, float yaw) {
+  size_t side = static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+  float spacing = 96.0f / side;
+  std::vector<ModelInstance> instances;
+  instances.reserve(count);
+
+  for(size_t i = 0; i < count; ++i) {
+    float x = (i % side) * spacing, y = (i / side % side) * spacing, z = (i / side / side) * spacing;
+    instances.push_back(ModelInstance::at(16.0f + x, 8.0f + y, 16.0f + z, spacing * 0.25f, yaw + i * 0.01f));
+  }
+
+  return instances;
+}
+
+// Static instances are copied once per frame slot, moving ones every frame, both go out in one draw per model
+int instancing(const std::vector<std::string>& args) {
+  std::vector<size_t> counts = {10000, 100000, 1000000};
+  int frames = 120;
+
+  for(const std::string& arg : args) {
+    if(arg.starts_with("--frames=")) {
+      frames = std::max(8, std::atoi(arg.substr(9).c_str()));
+    }
+  }
+
+  Renderer renderer(800, 600);
+  Terrain terrain;
+  renderer.uploadTerrain(terrain);
+
+  if(renderer.modelCount() == 0) {
+    std::print("!!!No model loaded from {}\n", config::modelPath);
+    return 1;
+  }
+
+  Player player(0.0f, 0.0f, 0.0f);
+  const CameraPath& orbit = cameraPaths.front();
+
+  std::print("==== instanced {} ({} frames each) ====\n", config::modelPath, frames);
+  for(size_t count : {size_t(0), counts[0], counts[1], counts[2]}) {
+    for(bool moving : {false, true}) {
+      if(count == 0 && moving) {
+        continue;
+      }
+
+      std::vector<ModelInstance> instances = instanceGrid(count, 0.0f);
+      renderer.setModelInstances(0, instances);
+
+      std::vector<double> cpu, gpu;
+      for(int i = 0; i < frames; ++i) {
+        orbit.move(player, static_cast<float>(i) / (frames - 1));
+
+        // Building the transforms is the game's cost, handing them over is the renderer's
+        if(moving) {
+          instances = instanceGrid(count, i * 0.05f);
+        }
+
+        Clock::time_point start = Clock::now();
+        if(moving) {
+          renderer.setModelInstances(0, instances);
+        }
+        renderer.drawFrame(&player, terrain);
+        cpu.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+        // The first frames still belong to the previous count
+        if(gpuWarmedUp(i)) {
+          gpu.push_back(renderer.lastGpuTimeMs());
+        }
+      }
+
+      std::string label = std::to_string(count) + (moving ? " moving" : "");
+      printTimes(label + " cpu", cpu);
+      printTimes(label + " gpu", gpu);
+    }
+  }
+
+  renderer.setModelInstances(0, {});
+  return 0;
+}
+
+// The flat map parser fileHandler had before the tape, every value copied out under its full path
+namespace naive {
+class FlatJSON {
+public:
+  std::unordered_map<std::string, std::string> um;
+  bool valid = false;
+
+  FlatJSON(std::span<const unsigned char> v) {
+    text = v;
+    valid = parseValue("");
+    skipWhitespace();
+    valid = valid && pos == text.size();
+  }
+
+  std::string get(const std::string& s) const {
+    auto it = um.find(s);
+    return it == um.end() ? "{}" : it->second;
+  }
+
+  static std::string formatJSON(std::span<const unsigned char> v) {
+    std::string result = "";
+    result.reserve(v.size() * 4);
+    int indentation = 0;
+
+    for(const unsigned char& uc : v) {
+      switch(uc) {
+        case '{': case '[':
+          result += uc;
+          result += '\n';
+          result.append(++indentation * 4, ' ');
+          break;
+        case '}': case ']':
+          result += '\n';
+          result.append(--indentation * 4, ' ');
+          result += uc;
+          result += '\n';
+          result.append(indentation * 4, ' ');
+          break;
+        case ',':
+          result += ",\n";
+          result.append(indentation * 4, ' ');
+          break;
+        default:
+          result += uc;
+          break;
+      }
+    }
+
+    return result;
+  }
+
+private:
+  std::span<const unsigned char> text;
+  size_t pos = 0;
+
+  void skipWhitespace() {
+    while(pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+      ++pos;
+    }
+  }
+
+  bool parseValue(const std::string& path) {
+    skipWhitespace();
+    if(pos >= text.size()) {
+      return false;
+    }
+
+    if(text[pos] == '{' || text[pos] == '[') {
+      return parseContainer(path, text[pos] == '{' ? '}' : ']');
+    }
+
+    if(text[pos] == '"') {
+      std::string value;
+      if(!parseString(value)) {
+        return false;
+      }
+      um[path] = std::move(value);
+      return true;
+    }
+
+    size_t start = pos;
+    while(pos < text.size() && (std::isalnum(text[pos]) || text[pos] == '-' || text[pos] == '+' || text[pos] == '.')) {
+      ++pos;
+    }
+    um[path] = std::string(text.begin() + start, text.begin() + pos);
+    return pos > start;
+  }
+
+  bool parseContainer(const std::string& path, char close) {
+    ++pos;
+    size_t count = 0;
+    skipWhitespace();
+
+    while(pos < text.size() && text[pos] != close) {
+      std::string key = std::to_string(count);
+      if(close == '}') {
+        key.clear();
+        skipWhitespace();
+        if(pos >= text.size() || text[pos] != '"' || !parseString(key)) {
+          return false;
+        }
+        skipWhitespace();
+        if(pos >= text.size() || text[pos++] != ':') {
+          return false;
+        }
+      }
+
+      if(!parseValue(path.empty() ? key : path + '.' + key)) {
+        return false;
+      }
+      ++count;
+
+      skipWhitespace();
+      if(pos < text.size() && text[pos] == ',') {
+        ++pos;
+      }
+    }
+
+    if(pos >= text.size()) {
+      return false;
+    }
+
+    ++pos;
+    um[path] = std::to_string(count);
+    return true;
+  }
+
+  bool parseString(std::string& out) {
+    ++pos;
+
+    while(pos < text.size() && text[pos] != '"') {
+      if(text[pos] != '\\') {
+        out += static_cast<char>(text[pos++]);
+        continue;
+      }
+
+      if(++pos >= text.size()) {
+        return false;
+      }
+
+      char c = static_cast<char>(text[pos++]);
+      if(c == 'u' && pos + 4 <= text.size()) {
+        uint32_t code = std::stoul(std::string(text.begin() + pos, text.begin() + pos + 4), nullptr, 16);
+        pos += 4;
+        if(code < 0x80) {
+          out += static_cast<char>(code);
+        } else if(code < 0x800) {
+          out += static_cast<char>(0xC0 | (code >> 6));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+          out += static_cast<char>(0xE0 | (code >> 12));
+          out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        continue;
+      }
+
+      out += c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c == 'b' ? '\b' : c == 'f' ? '\f' : c;
+    }
+
+    if(pos >= text.size()) {
+      return false;
+    }
+
+    ++pos;
+    return true;
+  }
+};
+} // namespace naive
+
+// glTF shaped, accessors with escaped names and number arrays until the document reaches the size
+std::string gltfDocument(size_t bytes, size_t& accessors) {
+  std::mt19937 rng(67);
+  std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+  std::string json = "{\n  \"asset\": {\"version\": \"2.0\", \"generator\": \"bench \\\"json\\\"\"},\n  \"accessors\": [\n";
+
+  for(accessors = 0; json.size() < bytes; ++accessors) {
+    json += std::format("{}    {{\"bufferView\": {}, \"componentType\": 5126, \"count\": {}, \"type\": \"VEC3\", \"max\": [{:.4f}, {:.4f}, {:.4f}], \"min\": [-1e2, -1E-2, 0], \"normalized\": false, \"name\": \"accessor\\u0020{}\\n\"}}",
+      accessors ? ",\n" : "", accessors, rng() % 65536, value(rng), value(rng), value(rng), accessors);
+  }
+
+  json += "\n  ],\n  \"scene\": 0,\n  \"extras\": null\n}\n";
+  return json;
+}
+
+int json(const std::vector<std::string>& args) {
+  size_t megabytes = 16;
+  for(const std::string& arg : args) {
+    if(arg.starts_with("--mb=")) {
+      megabytes = std::max(1, std::atoi(arg.substr(5).c_str()));
+    }
+  }
+
+  size_t accessors = 0;
+  std::string document = gltfDocument(megabytes << 20, accessors);
+  std::span<const unsigned char> bytes(reinterpret_cast<const unsigned char*>(document.data()), document.size());
+  double mb = document.size() / double(1 << 20);
+
+  std::vector<uint32_t> positions(document.size() + 1);
+  size_t structurals = 0;
+  double tokenize = bestMs(5, [&]() { structurals = fileHandler::ParseJSON::structurals(bytes, positions.data()); });
+
+  std::unique_ptr<naive::FlatJSON> flat;
+  std::unique_ptr<fileHandler::ParseJSON> tape;
+  double flatParse = bestMs(3, [&]() { flat = std::make_unique<naive::FlatJSON>(bytes); });
+  double tapeParse = bestMs(3, [&]() { tape = std::make_unique<fileHandler::ParseJSON>(bytes); });
+
+  if(!flat->valid || !tape->valid) {
+    std::print("!!!Generated document did not parse (flat {}, tape {})\n", flat->valid, tape->valid);
+    return 1;
+  }
+
+  // In order like a loader walking its accessors, then scattered over the whole document
+  std::mt19937 rng(67);
+  const char* fields[] = {"count", "name", "max.1", "min.1", "normalized", "type"};
+  std::vector<std::string> ordered = {"asset.generator", "accessors", "scene", "extras", "accessors.0", "missing.path"}, random = ordered;
+  for(size_t i = 0; i < 100000; ++i) {
+    ordered.push_back(std::format("accessors.{}.{}", i * accessors / 100000, fields[i % 6]));
+    random.push_back(std::format("accessors.{}.{}", rng() % accessors, fields[rng() % 6]));
+  }
+
+  size_t mismatches = 0, flatChecksum = 0, tapeChecksum = 0;
+  for(const std::string& path : random) {
+    mismatches += flat->get(path) != tape->get(path);
+  }
+
+  double lookups[2][2];
+  for(int order = 0; order < 2; ++order) {
+    const std::vector<std::string>& paths = order == 0 ? ordered : random;
+    lookups[order][0] = bestMs(3, [&]() { for(const std::string& path : paths) flatChecksum += flat->get(path).size(); });
+    lookups[order][1] = bestMs(3, [&]() { for(const std::string& path : paths) tapeChecksum += tape->get(path).size(); });
+  }
+
+  std::string flatFormatted, tapeFormatted;
+  double flatFormat = bestMs(3, [&]() { flatFormatted = naive::FlatJSON::formatJSON(bytes); });
+  double tapeFormat = bestMs(3, [&]() { tapeFormatted = fileHandler::ParseJSON::formatJSON(bytes); });
+
+  std::print("==== json ({:.1f} MB, {} accessors, {} structurals, {} tape nodes) ====\n", mb, accessors, structurals, tape->tapeSize);
+  std::print("{:>10}: {:>8.2f} ms {:>8.1f} MB/s\n", "tokenize", tokenize, mb / tokenize * 1e3);
+  std::print("{:>10}: flat {:>8.2f} ms {:>7.1f} MB/s, tape {:>8.2f} ms {:>7.1f} MB/s, {:.1f}x\n", "parse", flatParse, mb / flatParse * 1e3, tapeParse, mb / tapeParse * 1e3, flatParse / tapeParse);
+  std::print("{:>10}: flat {:>8.2f} ms, tape {:>8.2f} ms for {} paths in order, {:.1f}x\n", "lookup", lookups[0][0], lookups[0][1], ordered.size(), lookups[0][0] / lookups[0][1]);
+  std::print("{:>10}: flat {:>8.2f} ms, tape {:>8.2f} ms for {} random paths, {:.1f}x\n", "lookup", lookups[1][0], lookups[1][1], random.size(), lookups[1][0] / lookups[1][1]);
+  std::print("{:>10}: flat {:>8.2f} ms, tape {:>8.2f} ms, {:.1f}x\n", "format", flatFormat, tapeFormat, flatFormat / tapeFormat);
+
+  if(mismatches > 0 || flatFormatted != tapeFormatted || flatChecksum != tapeChecksum) {
+    std::print("!!!{} lookups differ from the flat parser, formatting {}\n", mismatches, flatFormatted == tapeFormatted ? "matches" : "differs");
+    return 1;
+  }
+
+  return 0;
+}
+
+// Only depends on the frame number, so every run walks the same path and sees the same chunks
+game::Input scriptedInput(uint64_t frame) {
+  float t = static_cast<float>(frame) / 60.0f;
+  // Turning at a steady rate keeps the walk circling inside the generated chunks
+  return {1.0f, std::sin(t * 0.5f) > 0.8f ? 1.0f : 0.0f, std::sin(t * 0.25f) * 0.2f, 4.0f + std::sin(t * 0.3f), std::sin(t * 0.7f) * 0.5f};
+}
+
+// The game loop at a fixed 60 Hz tick, on the null backend it measures only the CPU side of a frame
+int gameLoop(const std::vector<std::string>& args) {
+  uint64_t frames = 3600;
+  bool gpu = false;
+
+  for(const std::string& arg : args) {
+    if(arg.starts_with("--frames=")) {
+      frames = std::strtoull(arg.substr(9).c_str(), nullptr, 10);
+    } else if(arg == "--gpu") {
+      gpu = true;
+    }
+  }
+
+  std::unique_ptr<RenderBackend> renderer;
+  if(gpu) {
+    renderer = std::make_unique<Renderer>(800, 600);
+  } else {
+    renderer = std::make_unique<NullRenderer>(800, 600);
+  }
+
+  Terrain terrain;
+  renderer->uploadTerrain(terrain);
+  Player player(64.0f, 20.0f, 64.0f);
+  // The script steers up and down as well
+  player.setFlying(true);
+
+  const float dt = 1.0f / 60.0f;
+  std::vector<double> cpu;
+  cpu.reserve(frames);
+
+  std::print("==== game loop ({} frames on the {} renderer) ====\n", frames, gpu ? "vulkan" : "null");
+  for(uint64_t i = 0; i < frames; ++i) {
+    Clock::time_point start = Clock::now();
+
+    game::frame(*renderer, player, terrain, scriptedInput(i), dt);
+
+    cpu.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+  }
+
+  printTimes("frame cpu", cpu);
+  std::print("{}", renderer->gpuReport());
+  // Has to match between runs, otherwise the input is not deterministic
+  std::print("final position {:.4f} {:.4f} {:.4f} looking {:.4f} {:.4f}\n", player.x, player.y, player.z, player.mouseX, player.mouseY);
+  return 0;
+}
+
+// Drops the file from the page cache so the next read has to go to the disk
+void evict(const std::string& path) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd >= 0) {
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+#endif
+}
+
+std::vector<std::string> looseAssets() {
+  std::vector<std::string> paths;
+  std::error_code error;
+  for(const auto& file : std::filesystem::directory_iterator(config::assetRoot + "shaders", error)) {
+    if(file.path().extension() == ".spv") {
+      paths.push_back(file.path().string());
+    }
+  }
+
+  for(const std::string& layer : config::textureLayers) {
+    paths.push_back(config::assetRoot + layer);
+  }
+
+  paths.push_back(config::assetRoot + config::modelPath);
+  return paths;
+}
+
+// Everything the renderer needs in memory before the upload, returns how many bytes that was
+size_t loadLoose(const std::vector<std::string>& assets) {
+  size_t bytes = 0;
+  for(const std::string& path : assets) {
+    if(path.ends_with(".spv")) {
+      std::ifstream file(path, std::ios::ate | std::ios::binary);
+      std::vector<char> code(static_cast<size_t>(file.tellg()));
+      file.seekg(0);
+      file.read(code.data(), code.size());
+      bytes += code.size();
+    }
+  }
+
+  std::vector<std::string> layers;
+  for(const std::string& layer : config::textureLayers) {
+    layers.push_back(config::assetRoot + layer);
+  }
+
+  // Level 0 only, on a device that can blit the rest is made on the GPU
+  bytes += assetPack::decodeTextures(layers, false).pixels.size();
+
+  fileHandler::glTFmodel model(config::assetRoot + config::modelPath);
+  return bytes + (model.isValid() ? model.length : 0);
+}
+
+// Mapping alone reads nothing, so every page of every entry is touched as the upload would
+size_t loadPacked(const std::string& path) {
+  assetPack::Archive pack(path);
+  size_t bytes = 0;
+  volatile unsigned char sink = 0;
+
+  for(const assetPack::Entry& entry : pack.entries) {
+    std::span<const unsigned char> data = pack.bytes(entry);
+    for(size_t i = 0; i < data.size(); i += 4096) {
+      sink = sink + data[i];
+    }
+    bytes += data.size();
+  }
+
+  if(const assetPack::Entry* entry = pack.find(config::modelPath)) {
+    fileHandler::glTFmodel model(pack.bytes(*entry));
+    bytes -= model.isValid() ? 0 : entry->size;
+  }
+
+  return bytes;
+}
+
+int startup(const std::vector<std::string>& args) {
+  int runs = 5;
+  for(const std::string& arg : args) {
+    if(arg.starts_with("--runs=")) {
+      runs = std::max(1, std::atoi(arg.substr(7).c_str()));
+    }
+  }
+
+  std::string packPath = (std::filesystem::temp_directory_path() / "bench.pack").string();
+  if(!assetPack::build(packPath)) {
+    std::print("!!!Could not build the asset pack from {}\n", config::assetRoot);
+    return 1;
+  }
+
+  std::vector<std::string> loose = looseAssets();
+  {
+    std::vector<std::string> layers;
+    for(const std::string& layer : config::textureLayers) {
+      layers.push_back(config::assetRoot + layer);
+    }
+
+    assetPack::Archive pack(packPath);
+    const assetPack::Entry* texture = pack.find(assetPack::blockTextures);
+    std::vector<uint8_t> decoded = assetPack::decodeTextures(layers, true).pixels;
+    if(texture == nullptr || !std::ranges::equal(pack.bytes(*texture), decoded)) {
+      std::print("!!!Packed textures differ from the decoded files\n");
+      return 1;
+    }
+
+    std::print("==== startup ({} loose files, {} byte pack, best of {}) ====\n", loose.size(), pack.file.size, runs);
+  }
+
+  auto evictAll = [&] {
+    for(const std::string& path : loose) {
+      evict(path);
+    }
+    evict(packPath);
+  };
+
+  size_t looseBytes = 0, packedBytes = 0;
+  double looseCold = bestMs(runs, [&] { evictAll(); looseBytes = loadLoose(loose); });
+  double packedCold = bestMs(runs, [&] { evictAll(); packedBytes = loadPacked(packPath); });
+  double looseWarm = bestMs(runs, [&] { loadLoose(loose); });
+  double packedWarm = bestMs(runs, [&] { loadPacked(packPath); });
+
+  std::print("assets cold: loose {:>8.3f} ms packed {:>8.3f} ms ({:.1f}x)\n", looseCold, packedCold, looseCold / packedCold);
+  std::print("assets warm: loose {:>8.3f} ms packed {:>8.3f} ms ({:.1f}x)\n", looseWarm, packedWarm, looseWarm / packedWarm);
+  std::print("      bytes: loose {:>8} packed {:>8} (packed textures carry every mip level)\n", looseBytes, packedBytes);
+
+  // Device creation and pipelines dominate here, the pipeline cache is warm after the first run either way
+  looseCold = bestMs(runs, [&] { evictAll(); Renderer renderer(800, 600, ""); });
+  packedCold = bestMs(runs, [&] { evictAll(); Renderer renderer(800, 600, packPath); });
+  looseWarm = bestMs(runs, [&] { Renderer renderer(800, 600, ""); });
+  packedWarm = bestMs(runs, [&] { Renderer renderer(800, 600, packPath); });
+
+  std::print("  init cold: loose {:>8.3f} ms packed {:>8.3f} ms ({:.1f}x)\n", looseCold, packedCold, looseCold / packedCold);
+  std::print("  init warm: loose {:>8.3f} ms packed {:>8.3f} ms ({:.1f}x)\n", looseWarm, packedWarm, looseWarm / packedWarm);
+
+  // Up to the first submitted frame, with the world generated before the renderer starts or next to it as the game does
+  Player player(64.0f, 20.0f, 64.0f);
+  auto firstFrame = [&](bool overlap) {
+    double best = 1e30;
+
+    for(int run = 0; run < runs; ++run) {
+      Clock::time_point start = Clock::now();
+      taskGraph::TaskGraph graph;
+      std::optional<Terrain> terrain;
+      taskGraph::Task world = graph.add("generate world", {}, [&terrain] {
+        terrain.emplace();
+      });
+
+      if(!overlap) {
+        graph.wait(world);
+      }
+
+      Renderer renderer(800, 600, packPath);
+      graph.wait(world);
+      renderer.uploadTerrain(*terrain);
+      renderer.drawFrame(&player, *terrain);
+      best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    return best;
+  };
+
+  double serial = firstFrame(false);
+  double overlapped = firstFrame(true);
+  std::print("first frame: serial {:>8.3f} ms overlapped {:>8.3f} ms ({:.1f}x)\n", serial, overlapped, serial / overlapped);
+
+  std::filesystem::remove(packPath);
+  return 0;
+}
+
+bool embedded(const Terrain& terrain, const collision::Body& body) {
+  collision::Box box = collision::boxOf(body);
+  for(int x = static_cast<int>(std::floor(box.minX + 1e-6)); x < std::ceil(box.maxX - 1e-6); ++x) {
+    for(int y = static_cast<int>(std::floor(box.minY + 1e-6)); y < std::ceil(box.maxY - 1e-6); ++y) {
+      for(int z = static_cast<int>(std::floor(box.minZ + 1e-6)); z < std::ceil(box.maxZ - 1e-6); ++z) {
+        if(collision::solid(terrain, x, y, z)) {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+// Bodies dropped over the generated world, walking straight into its walls and jumping now and then
+int collisionBodies(const std::vector<std::string>& args) {
+  size_t count = 10000;
+  int ticks = 600;
+
+  for(const std::string& arg : args) {
+    if(arg.starts_with("--bodies=")) {
+      count = std::max<size_t>(1, std::strtoull(arg.substr(9).c_str(), nullptr, 10));
+    } else if(arg.starts_with("--ticks=")) {
+      ticks = std::max(1, std::atoi(arg.substr(8).c_str()));
+    }
+  }
+
+  Terrain terrain;
+  double sizeX = terrain.graph.sizeX * 16.0, sizeZ = terrain.graph.sizeZ * 16.0;
+  double top = (terrain.graph.minY + terrain.graph.sizeY) * 16.0;
+
+  std::mt19937 random(7);
+  std::uniform_real_distribution<double> height(top, top + 16.0);
+  std::uniform_real_distribution<float> turn(0.0f, 6.2831853f);
+  std::vector<collision::Body> bodies(count);
+  std::vector<float> headings(count);
+
+  for(size_t i = 0; i < count; ++i) {
+    bodies[i].x = std::uniform_real_distribution<double>(1.0, sizeX - 1.0)(random);
+    bodies[i].y = height(random);
+    bodies[i].z = std::uniform_real_distribution<double>(1.0, sizeZ - 1.0)(random);
+    headings[i] = turn(random);
+  }
+
+  std::vector<double> times;
+  times.reserve(ticks);
+
+  for(int tick = 0; tick < ticks; ++tick) {
+    Clock::time_point start = Clock::now();
+
+    for(size_t i = 0; i < count; ++i) {
+      collision::Body& body = bodies[i];
+      body.vx = std::sin(headings[i]) * 5.0f;
+      body.vz = std::cos(headings[i]) * 5.0f;
+      if(body.onGround && (tick + i) % 90 == 0) {
+        body.vy = collision::jumpSpeed;
+      }
+
+      collision::step(terrain, body, collision::tick);
+    }
+
+    times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+  }
+
+  size_t grounded = 0, stuck = 0, fallen = 0;
+  for(const collision::Body& body : bodies) {
+    grounded += body.onGround;
+    stuck += embedded(terrain, body);
+    fallen += body.y < terrain.graph.minY * 16.0 || body.x < 0.0 || body.x > sizeX || body.z < 0.0 || body.z > sizeZ;
+  }
+
+  std::sort(times.begin(), times.end());
+  double median = percentile(times, 0.5);
+
+  std::print("==== collision ({} bodies, {} ticks) ====\n", count, ticks);
+  printTimes("tick", times);
+  std::print("{:>11}: {:>9.0f} body steps/ms at the median tick\n", "throughput", count / median);
+  std::print("{:>11}: {} grounded, {} inside a block, {} out of the world\n", "end", grounded, stuck, fallen);
+
+  if(stuck > 0 || fallen > 0) {
+    std::print("!!!Bodies ended up inside blocks or got out of the world\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+int run(const std::string& name, const std::vector<std::string>& args) {
+  if(name == "cull") {
+    return frustumCulling();
+  }
+
+  if(name == "collision") {
+    return collisionBodies(args);
+  }
+
+  if(name == "gpucull") {
+    return gpuCulling();
+  }
+
+  if(name == "headless") {
+    return headless(args);
+  }
+
+  if(name == "batch") {
+    return batchKernels();
+  }
+
+  if(name == "calc") {
+    return math(args);
+  }
+
+  if(name == "instances") {
+    return instancing(args);
+  }
+
+  if(name == "json") {
+    return json(args);
+  }
+
+  if(name == "loop") {
+    return gameLoop(args);
+  }
+
+  if(name == "startup") {
+    return startup(args);
+  }
+
+  std::print("!!!Unknown benchmark: {}\n", name);
+  return 1;
+}
+} // namespace benchmark
@@ -1,5 +1,6 @@
 #include "../include/chunk.hpp"
 #include "../include/terrainGeneration.hpp"
+#include "../include/profiler.hpp"
 
 Chunk::Chunk() {
   this->x = 0;
@@ -9,6 +10,7 @@ Chunk::Chunk() {
 }
 
 Chunk::Chunk(int x, int y, int z, const std::array<calc::Vec2, 256>& v, float scale) {
+  PROFILE_ZONE("Chunk::Chunk");
   this->x = x << 4;
   this->y = y << 4;
   this->z = z << 4;
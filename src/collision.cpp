@@ -0,0 +1,190 @@
+#include "../include/collision.hpp"
+
+#include "../include/terrain.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace collision {
+// Faces closer than this count as touching, positions landed on a block face are off by a rounding error either way
+constexpr double skin = 1e-7;
+
+// Keeps the chunk of the last lookup, the blocks one sweep reads nearly always share it
+class BlockReader {
+public:
+  const Terrain& terrain;
+  int chunkX = INT_MIN, chunkY = INT_MIN, chunkZ = INT_MIN;
+  const Chunk* chunk = nullptr;
+  bool outside = false;
+
+  BlockReader(const Terrain& terrain) : terrain(terrain) {}
+
+  // Past the sides of the world and below its bottom counts as solid, so nothing walks or falls out of it
+  bool solid(int x, int y, int z) {
+    int cx = x >> 4, cy = y >> 4, cz = z >> 4;
+    if(cx != chunkX || cy != chunkY || cz != chunkZ) {
+      const visibility::ChunkGraph& graph = terrain.graph;
+      outside = cx < graph.minX || cx >= graph.minX + graph.sizeX || cz < graph.minZ || cz >= graph.minZ + graph.sizeZ || cy < graph.minY;
+      chunk = terrain.chunkAt(cx, cy, cz);
+      chunkX = cx;
+      chunkY = cy;
+      chunkZ = cz;
+    }
+
+    if(outside) {
+      return true;
+    }
+
+    return chunk != nullptr && chunk->blocks[(z & 15) + ((x & 15) << 4) + ((y & 15) << 8)] != Block::Air;
+  }
+};
+
+Box boxOf(const Body& body) {
+  return {body.x - body.halfWidth, body.y, body.z - body.halfWidth, body.x + body.halfWidth, body.y + body.height, body.z + body.halfWidth};
+}
+
+bool solid(const Terrain& terrain, int x, int y, int z) {
+  return BlockReader(terrain).solid(x, y, z);
+}
+
+double sweep(const Terrain& terrain, const Box& box, int axis, double distance) {
+  if(distance == 0.0) {
+    return 0.0;
+  }
+
+  const double low[3] = {box.minX, box.minY, box.minZ};
+  const double high[3] = {box.maxX, box.maxY, box.maxZ};
+  int b = (axis + 1) % 3, c = (axis + 2) % 3;
+
+  // Blocks the box only touches on the other axes are left out, so sliding along a floor or a wall is free
+  int fromB = static_cast<int>(std::floor(low[b] + skin)), toB = static_cast<int>(std::ceil(high[b] - skin)) - 1;
+  int fromC = static_cast<int>(std::floor(low[c] + skin)), toC = static_cast<int>(std::ceil(high[c] - skin)) - 1;
+
+  BlockReader reader(terrain);
+  auto layerSolid = [&](int layer) {
+    int coordinates[3];
+    coordinates[axis] = layer;
+
+    for(int i = fromB; i <= toB; ++i) {
+      coordinates[b] = i;
+      for(int j = fromC; j <= toC; ++j) {
+        coordinates[c] = j;
+        if(reader.solid(coordinates[0], coordinates[1], coordinates[2])) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  };
+
+  // Layers of blocks in front of the leading face, nearest first, the first solid one stops the box
+  if(distance > 0.0) {
+    int first = static_cast<int>(std::ceil(high[axis] - skin)), last = static_cast<int>(std::ceil(high[axis] + distance)) - 1;
+    for(int layer = first; layer <= last; ++layer) {
+      if(layerSolid(layer)) {
+        return std::clamp(layer - high[axis], 0.0, distance);
+      }
+    }
+  } else {
+    int first = static_cast<int>(std::floor(low[axis] + skin)) - 1, last = static_cast<int>(std::floor(low[axis] + distance));
+    for(int layer = first; layer >= last; --layer) {
+      if(layerSolid(layer)) {
+        return std::clamp(layer + 1 - low[axis], distance, 0.0);
+      }
+    }
+  }
+
+  return distance;
+}
+
+void offset(Box& box, int axis, double distance) {
+  double* low[3] = {&box.minX, &box.minY, &box.minZ};
+  double* high[3] = {&box.maxX, &box.maxY, &box.maxZ};
+  *low[axis] += distance;
+  *high[axis] += distance;
+}
+
+// Bodies can only get past the walls of the world by flying, they come back in before their first step
+void clampToWorld(const Terrain& terrain, Body& body) {
+  const visibility::ChunkGraph& graph = terrain.graph;
+  if(graph.sizeX == 0 || graph.sizeZ == 0) {
+    return;
+  }
+
+  body.x = std::clamp(body.x, graph.minX * 16.0 + body.halfWidth, (graph.minX + graph.sizeX) * 16.0 - body.halfWidth);
+  body.y = std::max(body.y, graph.minY * 16.0);
+  body.z = std::clamp(body.z, graph.minZ * 16.0 + body.halfWidth, (graph.minZ + graph.sizeZ) * 16.0 - body.halfWidth);
+}
+
+// Y first, so a body on the ground slides over it instead of catching on the blocks it stands on
+void step(const Terrain& terrain, Body& body, float dt) {
+  clampToWorld(terrain, body);
+  body.vy = std::max(body.vy - gravity * dt, -terminalVelocity);
+  double dx = body.vx * dt, dy = body.vy * dt, dz = body.vz * dt;
+
+  Box box = boxOf(body);
+  double movedY = sweep(terrain, box, 1, dy);
+  offset(box, 1, movedY);
+  Box grounded = box;
+
+  double movedX = sweep(terrain, box, 0, dx);
+  offset(box, 0, movedX);
+  double movedZ = sweep(terrain, box, 2, dz);
+  offset(box, 2, movedZ);
+
+  body.onGround = dy < 0.0 && movedY != dy;
+
+  // Blocked sideways while standing, so the same move is tried from up to a ledge higher and settled back down
+  if(body.onGround && (movedX != dx || movedZ != dz)) {
+    Box raised = grounded;
+    double up = sweep(terrain, raised, 1, stepHeight);
+    offset(raised, 1, up);
+
+    double raisedX = sweep(terrain, raised, 0, dx);
+    offset(raised, 0, raisedX);
+    double raisedZ = sweep(terrain, raised, 2, dz);
+    offset(raised, 2, raisedZ);
+    offset(raised, 1, sweep(terrain, raised, 1, -up));
+
+    if(raisedX * raisedX + raisedZ * raisedZ > movedX * movedX + movedZ * movedZ) {
+      movedY += raised.minY - grounded.minY;
+      movedX = raisedX;
+      movedZ = raisedZ;
+    }
+  }
+
+  if(movedX != dx) {
+    body.vx = 0.0f;
+  }
+
+  if(movedZ != dz) {
+    body.vz = 0.0f;
+  }
+
+  if(body.onGround || (dy > 0.0 && movedY < dy)) {
+    body.vy = 0.0f;
+  }
+
+  body.x += movedX;
+  body.y += movedY;
+  body.z += movedZ;
+}
+
+void drop(const Terrain& terrain, Body& body) {
+  const visibility::ChunkGraph& graph = terrain.graph;
+  if(graph.sizeY == 0) {
+    return;
+  }
+
+  clampToWorld(terrain, body);
+  double top = (graph.minY + graph.sizeY) * 16.0, bottom = graph.minY * 16.0;
+  Body lifted = body;
+  lifted.y = top;
+
+  // The sweep ends on the bottom of the world, which is solid below, so there is always ground
+  body.y = top + sweep(terrain, boxOf(lifted), 1, bottom - top);
+  body.vy = 0.0f;
+  body.onGround = true;
+}
+} // namespace collision
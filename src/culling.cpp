@@ -0,0 +1,100 @@
+#include "../include/culling.hpp"
+
+#include "../include/batch.hpp"
+#include "../include/config.hpp"
+#include "../include/profiler.hpp"
+#include "../include/terrain.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace culling {
+void ChunkBounds::clear() {
+  minX.clear();
+  minY.clear();
+  minZ.clear();
+  maxX.clear();
+  maxY.clear();
+  maxZ.clear();
+}
+
+void ChunkBounds::push(float x0, float y0, float z0, float x1, float y1, float z1) {
+  minX.push_back(x0);
+  minY.push_back(y0);
+  minZ.push_back(z0);
+  maxX.push_back(x1);
+  maxY.push_back(y1);
+  maxZ.push_back(z1);
+}
+
+size_t ChunkBounds::size() const {
+  return minX.size();
+}
+
+batch::Boxes boxesOf(const ChunkBounds& bounds) {
+  return {bounds.minX.data(), bounds.minY.data(), bounds.minZ.data(), bounds.maxX.data(), bounds.maxY.data(), bounds.maxZ.data(), bounds.size()};
+}
+
+size_t cullChunksScalar(const ChunkBounds& bounds, const std::array<calc::Vec4, 6>& planes, std::vector<uint32_t>& visible) {
+  return batch::boxesInside(planes, boxesOf(bounds), visible, batch::Path::Scalar);
+}
+
+size_t cullChunks(const ChunkBounds& bounds, const std::array<calc::Vec4, 6>& planes, std::vector<uint32_t>& visible) {
+  return batch::boxesInside(planes, boxesOf(bounds), visible);
+}
+
+void DistanceSorter::sort(const ChunkBounds& bounds, float x, float y, float z, std::vector<uint32_t>& chunks) {
+  items.resize(chunks.size());
+  scratch.resize(chunks.size());
+
+  for(size_t i = 0; i < chunks.size(); ++i) {
+    uint32_t c = chunks[i];
+    float dx = std::max({bounds.minX[c] - x, 0.0f, x - bounds.maxX[c]});
+    float dy = std::max({bounds.minY[c] - y, 0.0f, y - bounds.maxY[c]});
+    float dz = std::max({bounds.minZ[c] - z, 0.0f, z - bounds.maxZ[c]});
+
+    // Positive floats order like their bits, the top half keeps finer steps close to the camera
+    uint64_t key = std::bit_cast<uint32_t>(dx * dx + dy * dy + dz * dz) >> 16;
+    items[i] = key << 32 | c;
+  }
+
+  for(int shift = 32; shift < 48; shift += 8) {
+    std::array<size_t, 256> offsets{};
+    for(uint64_t item : items) {
+      ++offsets[(item >> shift) & 0xFF];
+    }
+
+    size_t total = 0;
+    for(size_t& offset : offsets) {
+      size_t count = offset;
+      offset = total;
+      total += count;
+    }
+
+    for(uint64_t item : items) {
+      scratch[offsets[(item >> shift) & 0xFF]++] = item;
+    }
+
+    items.swap(scratch);
+  }
+
+  for(size_t i = 0; i < chunks.size(); ++i) {
+    chunks[i] = static_cast<uint32_t>(items[i]);
+  }
+}
+
+size_t drawList(const Terrain& terrain, const std::array<calc::Vec4, 6>& planes, const std::vector<uint8_t>& reachable, float x, float y, float z, DistanceSorter* sorter, std::vector<uint32_t>& visible) {
+  uint32_t slots = std::min(static_cast<uint32_t>(terrain.meshes.size()), config::maxChunkDraws);
+
+  cullChunks(terrain.bounds, planes, visible);
+  std::erase_if(visible, [&](uint32_t chunk) {
+    return chunk >= slots || !terrain.meshes[chunk].uploaded || !reachable[chunk];
+  });
+
+  if(sorter != nullptr) {
+    PROFILE_ZONE("sort chunks");
+    sorter->sort(terrain.bounds, x, y, z, visible);
+  }
+
+  return visible.size();
+}
+} // namespace culling
@@ -0,0 +1,72 @@
+#include "../include/deletionQueue.hpp"
+
+#include <algorithm>
+
+void DeletionQueue::buffer(uint64_t frame, VkBuffer buffer) {
+  PendingDeletion deletion{frame, DeletionKind::Buffer};
+  deletion.buffer = buffer;
+  push(deletion);
+}
+
+void DeletionQueue::memory(uint64_t frame, VkDeviceMemory memory) {
+  PendingDeletion deletion{frame, DeletionKind::Memory};
+  deletion.memory = memory;
+  push(deletion);
+}
+
+void DeletionQueue::descriptorSet(uint64_t frame, VkDescriptorPool pool, VkDescriptorSet set) {
+  PendingDeletion deletion{frame, DeletionKind::DescriptorSet};
+  deletion.pool = pool;
+  deletion.set = set;
+  push(deletion);
+}
+
+void DeletionQueue::range(uint64_t frame, RangeAllocator& allocator, const ArenaRange& range) {
+  PendingDeletion deletion{frame, DeletionKind::Range};
+  deletion.allocator = &allocator;
+  deletion.range = range;
+  push(deletion);
+}
+
+// Frames retire in submission order, so the queue only ever pops from the front
+size_t DeletionQueue::retire(VkDevice device, uint64_t completedFrame) {
+  size_t freed = 0;
+
+  while(!pending.empty() && pending.front().frame <= completedFrame) {
+    destroy(device, pending.front());
+    pending.pop_front();
+    ++freed;
+  }
+
+  return freed;
+}
+
+size_t DeletionQueue::flush(VkDevice device) {
+  return retire(device, UINT64_MAX);
+}
+
+// Keeps the frames sorted even if a caller tags something with an older frame
+void DeletionQueue::push(PendingDeletion deletion) {
+  if(!pending.empty()) {
+    deletion.frame = std::max(deletion.frame, pending.back().frame);
+  }
+
+  pending.push_back(deletion);
+}
+
+void DeletionQueue::destroy(VkDevice device, const PendingDeletion& deletion) {
+  switch(deletion.kind) {
+    case DeletionKind::Buffer:
+      vkDestroyBuffer(device, deletion.buffer, nullptr);
+      break;
+    case DeletionKind::Memory:
+      vkFreeMemory(device, deletion.memory, nullptr);
+      break;
+    case DeletionKind::DescriptorSet:
+      vkFreeDescriptorSets(device, deletion.pool, 1, &deletion.set);
+      break;
+    case DeletionKind::Range:
+      deletion.allocator->free(deletion.range);
+      break;
+  }
+}
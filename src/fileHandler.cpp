@@ -1,103 +1,660 @@
 #include "../include/fileHandler.hpp"
 #include <print>
-#include <fstream>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace fileHandler {
-  int ParseJSON::trimKey(const std::string &s) {
-    int i = s.size() - 1;
+  MappedFile::MappedFile(const std::string &fileName) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+      return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+      CloseHandle(handle);
+      return;
+    }
+
+    // The view keeps the mapping alive, neither handle is needed after this
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);
+    if (mapping == nullptr) {
+      return;
+    }
 
-    while (s[i] != '.') {
-      --i;
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+      return;
     }
 
-    return i - 1;
+    this->data = static_cast<const unsigned char *>(view);
+    this->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int descriptor = open(fileName.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      return;
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+      close(descriptor);
+      return;
+    }
+
+    void *view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (view == MAP_FAILED) {
+      return;
+    }
+
+    this->data = static_cast<const unsigned char *>(view);
+    this->size = static_cast<size_t>(status.st_size);
+#endif
   }
 
-  ParseJSON::ParseJSON(const std::vector<unsigned char> &v) {
-    int pos = 1;
-    std::string key = "";
-    std::string value = "";
+  MappedFile::MappedFile(MappedFile &&other) noexcept {
+    this->data = std::exchange(other.data, nullptr);
+    this->size = std::exchange(other.size, 0);
+  }
 
-    while (pos < v.size() - 1) {
-      ++pos;
+  MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    // Our old mapping goes away with other
+    std::swap(this->data, other.data);
+    std::swap(this->size, other.size);
+
+    return *this;
+  }
+
+  MappedFile::~MappedFile() {
+    if (this->data == nullptr) {
+      return;
     }
+
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+#else
+    munmap(const_cast<unsigned char *>(this->data), this->size);
+#endif
+    this->data = nullptr;
+    this->size = 0;
   }
 
-  std::string ParseJSON::get(const std::string &s) {
-    if (um.find(s) == um.end()) {
-      return "{}";
-    } else {
-      return um.at(s);
+  bool MappedFile::isOpen() const {
+    return this->data != nullptr;
+  }
+
+  std::span<const unsigned char> MappedFile::bytes() const {
+    return {this->data, this->size};
+  }
+
+  // Bitmasks of one 64 byte block, bit i is byte i
+  struct BlockMasks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t operators = 0;
+  };
+
+#if defined(__SSE2__)
+  inline uint64_t matches(const __m128i (&bytes)[4], char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+
+    for (int i = 0; i < 4; ++i) {
+      mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes[i], needle)))) << (i * 16);
     }
+
+    return mask;
   }
 
-  std::string ParseJSON::formatJSON(const std::vector<unsigned char> &v) {
-    std::string result = "";
-    result.reserve(v.size() * 4);
-    int indentation = 0;
+  inline BlockMasks blockMasks(const unsigned char *block) {
+    __m128i bytes[4];
+    for (int i = 0; i < 4; ++i) {
+      bytes[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+    }
 
-    for (const unsigned char &uc : v) {
-      switch (uc) {
-      case '{':
-        result += "{\n";
-        result.append(++indentation * 4, ' ');
-        break;
-      case '}':
-        result += '\n';
-        result.append(--indentation * 4, ' ');
-        result += "}\n";
-        result.append(indentation * 4, ' ');
-        break;
-      case '[':
-        result += "[\n";
-        result.append(++indentation * 4, ' ');
-        break;
-      case ']':
-        result += '\n';
-        result.append(--indentation * 4, ' ');
-        result += "]\n";
-        result.append(indentation * 4, ' ');
+    return {matches(bytes, '"'), matches(bytes, '\\'),
+            matches(bytes, '{') | matches(bytes, '}') | matches(bytes, '[') | matches(bytes, ']') | matches(bytes, ':') | matches(bytes, ',')};
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  inline uint64_t matches(const uint8x16_t (&bytes)[4], char c) {
+    const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+    uint64_t mask = 0;
+
+    for (int i = 0; i < 4; ++i) {
+      uint8x16_t bits = vandq_u8(vceqq_u8(bytes[i], needle), weights);
+      mask |= static_cast<uint64_t>(vaddv_u8(vget_low_u8(bits)) | (vaddv_u8(vget_high_u8(bits)) << 8)) << (i * 16);
+    }
+
+    return mask;
+  }
+
+  inline BlockMasks blockMasks(const unsigned char *block) {
+    uint8x16_t bytes[4];
+    for (int i = 0; i < 4; ++i) {
+      bytes[i] = vld1q_u8(block + i * 16);
+    }
+
+    return {matches(bytes, '"'), matches(bytes, '\\'),
+            matches(bytes, '{') | matches(bytes, '}') | matches(bytes, '[') | matches(bytes, ']') | matches(bytes, ':') | matches(bytes, ',')};
+  }
+#else
+  inline BlockMasks blockMasks(const unsigned char *block) {
+    BlockMasks masks;
+
+    for (int i = 0; i < 64; ++i) {
+      uint64_t bit = uint64_t(1) << i;
+      switch (block[i]) {
+      case '"': masks.quote |= bit; break;
+      case '\\': masks.backslash |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': case ',': masks.operators |= bit; break;
+      default: break;
+      }
+    }
+
+    return masks;
+  }
+#endif
+
+  // Bit i is set when an odd number of quotes is at or before it
+  inline uint64_t prefixXor(uint64_t mask) {
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+  }
+
+  // Hands every 64 byte block to found with its unescaped quotes and its {}[]:, outside strings
+  template <typename F> void scanBlocks(std::span<const unsigned char> text, F &&found) {
+    // Carried between blocks, a string still open and a backslash escaping the next block's first byte
+    uint64_t inString = 0;
+    uint64_t escapeCarry = 0;
+    alignas(16) unsigned char tail[64];
+
+    for (size_t base = 0; base < text.size(); base += 64) {
+      const unsigned char *block = text.data() + base;
+      if (text.size() - base < 64) {
+        std::memset(tail, ' ', sizeof(tail));
+        std::memcpy(tail, block, text.size() - base);
+        block = tail;
+      }
+
+      BlockMasks masks = blockMasks(block);
+
+      // Backslash runs are rare, walking them one by one beats the branchless odd-run trick on real files
+      uint64_t escaped = escapeCarry;
+      escapeCarry = 0;
+      for (uint64_t backslash = masks.backslash & ~escaped; backslash; backslash &= backslash - 1) {
+        int bit = std::countr_zero(backslash);
+        if (escaped & (uint64_t(1) << bit)) {
+          continue;
+        }
+
+        if (bit == 63) {
+          escapeCarry = 1;
+        } else {
+          escaped |= uint64_t(1) << (bit + 1);
+        }
+      }
+
+      uint64_t quotes = masks.quote & ~escaped;
+      uint64_t strings = prefixXor(quotes) ^ inString;
+      inString = static_cast<uint64_t>(static_cast<int64_t>(strings) >> 63);
+
+      found(base, quotes, masks.operators & ~strings);
+    }
+  }
+
+  size_t ParseJSON::structurals(std::span<const unsigned char> text, uint32_t *out) {
+    size_t count = 0;
+
+    scanBlocks(text, [&](size_t base, uint64_t quotes, uint64_t operators) {
+      for (uint64_t structural = quotes | operators; structural; structural &= structural - 1) {
+        out[count++] = static_cast<uint32_t>(base + std::countr_zero(structural));
+      }
+    });
+
+    return count;
+  }
+
+  ParseJSON::ParseJSON(std::span<const unsigned char> v) {
+    if (v.size() >= UINT32_MAX) {
+      fail("documents over 4 GiB are not supported", 0);
+      return;
+    }
+
+    this->text = v;
+    this->source = std::string_view(reinterpret_cast<const char *>(v.data()), v.size());
+    uint32_t *structuralIndices = arena.allocate<uint32_t>(v.size() + 1);
+    this->indexCount = structurals(v, structuralIndices);
+    this->indices = structuralIndices;
+
+    // Every value starts at a structural or is a literal followed by one, so this bounds the tape
+    this->tape = arena.allocate<JSONNode>(this->indexCount + 1);
+    this->tapeSize = 0;
+    this->cursor = 0;
+    this->consumed = 0;
+
+    this->valid = parseValue(0);
+
+    // GLB pads the JSON chunk with spaces, anything else after the root is an error
+    if (this->valid && (this->cursor != this->indexCount || skipWhitespace(this->consumed) != v.size())) {
+      this->valid = fail("trailing data", skipWhitespace(this->consumed));
+    }
+
+    if (!this->valid) {
+      this->tapeSize = 0;
+    }
+
+    this->text = {};
+    this->indices = nullptr;
+    indexLongArrays();
+  }
+
+  // Built up front so lookups do not have to write
+  void ParseJSON::indexLongArrays() {
+    for (uint32_t nodeIndex = 0; nodeIndex < tapeSize; ++nodeIndex) {
+      if (tape[nodeIndex].type != JSONType::Array || tape[nodeIndex].size <= 16) {
+        continue;
+      }
+
+      uint32_t *offsets = arena.allocate<uint32_t>(tape[nodeIndex].size);
+      uint32_t element = nodeIndex + 1;
+      for (uint32_t i = 0; i < tape[nodeIndex].size; ++i) {
+        offsets[i] = element;
+        element = tape[element].next;
+      }
+
+      arrayIndexes.push_back(offsets);
+      tape[nodeIndex].offset = static_cast<uint32_t>(arrayIndexes.size());
+    }
+  }
+
+  size_t ParseJSON::skipWhitespace(size_t from) const {
+    while (from < text.size() && (text[from] == ' ' || text[from] == '\t' || text[from] == '\n' || text[from] == '\r')) {
+      ++from;
+    }
+
+    return from;
+  }
+
+  bool ParseJSON::fail(const char *what, size_t at) {
+    std::print("!!!Invalid JSON at byte {}: {}\n", at, what);
+    return false;
+  }
+
+  bool ParseJSON::parseValue(uint32_t depth) {
+    size_t start = skipWhitespace(consumed);
+    if (start >= text.size()) {
+      return fail("unexpected end", start);
+    }
+
+    // Anything not starting at the next structural is a literal running up to it
+    if (cursor >= indexCount || indices[cursor] != start) {
+      return parseLiteral();
+    }
+
+    switch (text[start]) {
+    case '{':
+      return parseContainer(JSONType::Object, depth);
+    case '[':
+      return parseContainer(JSONType::Array, depth);
+    case '"':
+      return parseString();
+    default:
+      return fail("unexpected character", start);
+    }
+  }
+
+  bool ParseJSON::parseContainer(JSONType type, uint32_t depth) {
+    if (depth >= 1024) {
+      return fail("nested too deep", indices[cursor]);
+    }
+
+    const char close = type == JSONType::Object ? '}' : ']';
+    uint32_t node = tapeSize++;
+    tape[node] = {type, 0, 0, 0};
+    consumed = indices[cursor++] + 1;
+
+    if (cursor < indexCount && text[indices[cursor]] == close && skipWhitespace(consumed) == indices[cursor]) {
+      consumed = indices[cursor++] + 1;
+      tape[node].next = tapeSize;
+      return true;
+    }
+
+    while (true) {
+      if (type == JSONType::Object) {
+        if (cursor >= indexCount || skipWhitespace(consumed) != indices[cursor] || text[indices[cursor]] != '"' || !parseString()) {
+          return fail("expected a key", skipWhitespace(consumed));
+        }
+
+        if (cursor >= indexCount || text[indices[cursor]] != ':' || skipWhitespace(consumed) != indices[cursor]) {
+          return fail("expected ':'", skipWhitespace(consumed));
+        }
+        consumed = indices[cursor++] + 1;
+      }
+
+      if (!parseValue(depth + 1)) {
+        return false;
+      }
+      ++tape[node].size;
+
+      if (cursor >= indexCount || skipWhitespace(consumed) != indices[cursor]) {
+        return fail(type == JSONType::Object ? "expected ',' or '}'" : "expected ',' or ']'", skipWhitespace(consumed));
+      }
+
+      char c = static_cast<char>(text[indices[cursor]]);
+      consumed = indices[cursor++] + 1;
+
+      if (c == close) {
         break;
-      case ',':
-        result += ",\n";
-        result.append(indentation * 4, ' ');
+      }
+      if (c != ',') {
+        return fail(type == JSONType::Object ? "expected ',' or '}'" : "expected ',' or ']'", consumed - 1);
+      }
+    }
+
+    tape[node].next = tapeSize;
+    return true;
+  }
+
+  // The tokenizer pairs every opening quote with its closing one
+  bool ParseJSON::parseString() {
+    if (cursor + 1 >= indexCount) {
+      return fail("unterminated string", indices[cursor]);
+    }
+
+    uint32_t open = indices[cursor], close = indices[cursor + 1];
+    cursor += 2;
+    consumed = close + 1;
+
+    tape[tapeSize] = {JSONType::String, tapeSize + 1, open + 1, close - open - 1};
+    ++tapeSize;
+    return true;
+  }
+
+  bool ParseJSON::parseLiteral() {
+    size_t start = skipWhitespace(consumed);
+    size_t end = cursor < indexCount ? indices[cursor] : text.size();
+
+    size_t last = end;
+    while (last > start && (text[last - 1] == ' ' || text[last - 1] == '\t' || text[last - 1] == '\n' || text[last - 1] == '\r')) {
+      --last;
+    }
+
+    std::string_view literal(reinterpret_cast<const char *>(text.data()) + start, last - start);
+    JSONType type;
+
+    if (literal == "true") {
+      type = JSONType::True;
+    } else if (literal == "false") {
+      type = JSONType::False;
+    } else if (literal == "null") {
+      type = JSONType::Null;
+    } else {
+      double number;
+      auto [ptr, error] = std::from_chars(literal.data(), literal.data() + literal.size(), number);
+      if (literal.empty() || error != std::errc() || ptr != literal.data() + literal.size() || literal[0] == '+') {
+        return fail("unexpected character", start);
+      }
+      type = JSONType::Number;
+    }
+
+    tape[tapeSize] = {type, tapeSize + 1, static_cast<uint32_t>(start), static_cast<uint32_t>(literal.size())};
+    ++tapeSize;
+    consumed = end;
+    return true;
+  }
+
+  const JSONNode *ParseJSON::child(const JSONNode *node, std::string_view segment) const {
+    if (node->type == JSONType::Object) {
+      // Raw key text, keys with escapes in them only match their escaped spelling
+      const JSONNode *key = node + 1;
+      for (uint32_t i = 0; i < node->size; ++i) {
+        const JSONNode *value = key + 1;
+        if (key->size == segment.size() && view(key) == segment) {
+          return value;
+        }
+        key = tape + value->next;
+      }
+
+      return nullptr;
+    }
+
+    if (node->type != JSONType::Array) {
+      return nullptr;
+    }
+
+    uint32_t index;
+    auto [ptr, error] = std::from_chars(segment.data(), segment.data() + segment.size(), index);
+    if (error != std::errc() || ptr != segment.data() + segment.size() || index >= node->size) {
+      return nullptr;
+    }
+
+    // Short arrays are walked, long ones have their child offsets from the constructor
+    if (node->size <= 16) {
+      const JSONNode *element = node + 1;
+      for (uint32_t i = 0; i < index; ++i) {
+        element = tape + element->next;
+      }
+
+      return element;
+    }
+
+    return tape + arrayIndexes[node->offset - 1][index];
+  }
+
+  const JSONNode *ParseJSON::find(std::string_view path) const {
+    if (tapeSize == 0) {
+      return nullptr;
+    }
+
+    const JSONNode *node = tape;
+    while (!path.empty() && node != nullptr) {
+      size_t dot = path.find('.');
+      node = child(node, path.substr(0, dot));
+      path = dot == std::string_view::npos ? std::string_view() : path.substr(dot + 1);
+    }
+
+    return node;
+  }
+
+  std::string_view ParseJSON::view(const JSONNode *node) const {
+    return source.substr(node->offset, node->size);
+  }
+
+  bool ParseJSON::has(const std::string &s) const {
+    return find(s) != nullptr;
+  }
+
+  std::string ParseJSON::get(const std::string &s) const {
+    const JSONNode *node = find(s);
+
+    if (node == nullptr) {
+      return "{}";
+    }
+
+    switch (node->type) {
+    case JSONType::Object:
+    case JSONType::Array:
+      return std::to_string(node->size);
+    case JSONType::String:
+      return unescape(view(node));
+    default:
+      return std::string(view(node));
+    }
+  }
+
+  size_t ParseJSON::getUnsigned(const std::string &s, size_t fallback) const {
+    const JSONNode *node = find(s);
+    size_t value;
+
+    if (node == nullptr || node->type != JSONType::Number) {
+      return fallback;
+    }
+
+    std::string_view text = view(node);
+    auto [ptr, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && ptr == text.data() + text.size() ? value : fallback;
+  }
+
+  std::string ParseJSON::unescape(std::string_view text) {
+    if (text.find('\\') == std::string_view::npos) {
+      return std::string(text);
+    }
+
+    std::string out;
+    out.reserve(text.size());
+
+    for (size_t pos = 0; pos < text.size();) {
+      if (text[pos] != '\\' || pos + 1 >= text.size()) {
+        out += text[pos++];
+        continue;
+      }
+
+      ++pos;
+      switch (text[pos++]) {
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        uint32_t code = 0;
+        auto [ptr, error] = std::from_chars(text.data() + pos, text.data() + std::min(pos + 4, text.size()), code, 16);
+        if (error != std::errc() || ptr != text.data() + pos + 4) {
+          out += "\\u";
+          break;
+        }
+        pos += 4;
+
+        // Surrogate pairs are not joined, glTF keys and URIs are ASCII in practice
+        if (code < 0x80) {
+          out += static_cast<char>(code);
+        } else if (code < 0x800) {
+          out += static_cast<char>(0xC0 | (code >> 6));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+          out += static_cast<char>(0xE0 | (code >> 12));
+          out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        }
         break;
+      }
       default:
-        result += uc;
+        out += text[pos - 1];
         break;
       }
     }
 
+    return out;
+  }
+
+  // Copies everything between structurals in one go, and leaves strings alone
+  std::string ParseJSON::formatJSON(std::span<const unsigned char> v) {
+    std::string result = "";
+    result.reserve(v.size() * 4);
+    const char *source = reinterpret_cast<const char *>(v.data());
+    size_t copied = 0;
+    int indentation = 0;
+
+    scanBlocks(v, [&](size_t base, uint64_t, uint64_t operators) {
+      for (; operators; operators &= operators - 1) {
+        size_t position = base + std::countr_zero(operators);
+        char c = source[position];
+
+        result.append(source + copied, position - copied);
+        copied = position + 1;
+
+        switch (c) {
+        case '{':
+        case '[':
+          result += c;
+          result += '\n';
+          result.append(++indentation * 4, ' ');
+          break;
+        case '}':
+        case ']':
+          result += '\n';
+          result.append(--indentation * 4, ' ');
+          result += c;
+          result += '\n';
+          result.append(indentation * 4, ' ');
+          break;
+        case ',':
+          result += ",\n";
+          result.append(indentation * 4, ' ');
+          break;
+        default:
+          result += c;
+          break;
+        }
+      }
+    });
+
+    result.append(source + copied, v.size() - copied);
     return result;
   }
 
-  glTFchunk::glTFchunk(uint32_t type, std::vector<unsigned char> &&chunkData) {
+  glTFchunk::glTFchunk(uint32_t type, std::span<const unsigned char> chunkData) {
     this->type = type;
-    this->data = std::move(chunkData);
+    this->data = chunkData;
   }
 
-  glTFmodel::glTFmodel(const std::string &fileName) {
-    this->chunks = {};
-    std::ifstream file(fileName, std::ios::binary | std::ios::in);
-
-    if (!file || !file.is_open() || file.fail()) {
+  glTFmodel::glTFmodel(const std::string &fileName) : file(fileName) {
+    if (!this->file.isOpen()) {
       std::print("!!!Couldn't open/find file: {}\n", fileName);
-      this->magic = 0;
-      this->version = 0;
-      this->length = 0;
       return;
     }
 
-    file.seekg(0);
+    this->parse(this->file.bytes());
+  }
+
+  glTFmodel::glTFmodel(std::span<const unsigned char> bytes) {
+    this->parse(bytes);
+  }
+
+  void glTFmodel::parse(std::span<const unsigned char> bytes) {
     uint32_t header[3];
-    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (bytes.size() < sizeof(header)) {
+      std::print("!!!Too short for a .glb header ({} bytes)\n", bytes.size());
+      return;
+    }
+    std::memcpy(header, bytes.data(), sizeof(header));
 
     if (header[0] != glTFmagicValue) {
       std::print("!!!File not .glb (found: {}, expected: 0x{:08X})\n",
                  header[0], glTFmagicValue);
-      this->magic = 0;
-      this->version = 0;
-      this->length = 0;
+      return;
+    }
+
+    if (header[2] > bytes.size()) {
+      std::print("!!!File truncated (header says {} bytes, found {})\n", header[2], bytes.size());
       return;
     }
 
@@ -106,20 +663,28 @@ namespace fileHandler {
     this->length = header[2];
     this->chunks.reserve(2);
 
-    uint32_t size = header[2] - sizeof(header);
-    while (size) {
+    size_t offset = sizeof(header);
+    while (offset + 8 <= this->length) {
       uint32_t data[2];
+      std::memcpy(data, bytes.data() + offset, sizeof(data));
+      offset += sizeof(data);
 
-      file.read(reinterpret_cast<char *>(&data), sizeof(data));
-      glTFchunk newChunk(data[1], std::vector<unsigned char>(data[0]));
-      file.read(reinterpret_cast<char *>(newChunk.data.data()), data[0]);
+      if (data[0] > this->length - offset) {
+        std::print("!!!Chunk {} runs past the end of the file\n", this->chunks.size());
+        break;
+      }
 
-      this->chunks.push_back(newChunk);
+      this->chunks.emplace_back(data[1], bytes.subspan(offset, data[0]));
+      offset += data[0];
+    }
 
-      size -= sizeof(data) + data[0];
+    if (!this->chunks.empty() && this->chunks.front().type == chunkType::JSON) {
+      this->json = ParseJSON(this->chunks.front().data);
     }
+  }
 
-    file.close();
+  bool glTFmodel::isValid() const {
+    return this->magic == glTFmagicValue && this->json.valid;
   }
 
   void glTFmodel::info() {
@@ -136,59 +701,79 @@ namespace fileHandler {
     }
   }
 
-  std::vector<std::tuple<float, float, float>> glTFmodel::getVertices() {
-    std::vector<std::tuple<float, float, float>> vertices = {};
+  std::span<const unsigned char> glTFmodel::binary() const {
+    for (const glTFchunk &chunk : this->chunks) {
+      if (chunk.type == chunkType::BIN) {
+        return chunk.data;
+      }
+    }
+
+    return {};
+  }
+
+  bool glTFmodel::accessorLayout(size_t index, AccessorLayout &layout) const {
+    std::string accessor = "accessors." + std::to_string(index);
+    if (!json.has(accessor + ".bufferView")) {
+      std::print("!!!Accessor {} missing or sparse\n", index);
+      return false;
+    }
 
-    std::string s(this->chunks.front().data.begin(),
-                  this->chunks.front().data.end());
-    int pos = s.find("meshes");
+    size_t componentSize = 0;
+    layout.componentType = static_cast<uint32_t>(json.getUnsigned(accessor + ".componentType", 0));
+    switch (layout.componentType) {
+    case componentType::BYTE:
+    case componentType::UNSIGNED_BYTE:
+      componentSize = 1;
+      break;
+    case componentType::SHORT:
+    case componentType::UNSIGNED_SHORT:
+      componentSize = 2;
+      break;
+    case componentType::UNSIGNED_INT:
+    case componentType::FLOAT:
+      componentSize = 4;
+      break;
+    default:
+      std::print("!!!Accessor {} has unknown componentType {}\n", index, layout.componentType);
+      return false;
+    }
 
-    int pos2 = pos + 9;
-    int e = 1;
-    while (e > 0) {
-      if (this->chunks.front().data[pos2] == '[') {
-        ++e;
-      }
-      if (this->chunks.front().data[pos2] == ']') {
-        --e;
-      }
-      ++pos2;
+    const std::unordered_map<std::string, size_t> components = {
+      {"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4}, {"MAT2", 4}, {"MAT3", 9}, {"MAT4", 16}};
+    auto type = components.find(json.get(accessor + ".type"));
+    if (type == components.end()) {
+      std::print("!!!Accessor {} has unknown type {}\n", index, json.get(accessor + ".type"));
+      return false;
     }
 
-    std::string s1(s.begin() + pos + 8, s.begin() + pos2);
-    int pos3 = s1.find("POSITION");
+    std::string view = "bufferViews." + json.get(accessor + ".bufferView");
+    layout.elementSize = componentSize * type->second;
+    layout.count = json.getUnsigned(accessor + ".count", 0);
+    layout.offset = json.getUnsigned(view + ".byteOffset", 0) + json.getUnsigned(accessor + ".byteOffset", 0);
 
-    std::string s2(s1.begin() + pos3 + sizeof("POSITION\""),
-                   s1.begin() + s1.find(',', pos3));
-    int index = std::stoi(s2);
+    size_t viewEnd = json.getUnsigned(view + ".byteOffset", 0) + json.getUnsigned(view + ".byteLength", 0);
+    size_t stride = json.getUnsigned(view + ".byteStride", layout.elementSize);
 
-    int pos4 = s.find("bufferViews") + sizeof("bufferViews\":");
-    int pos5 = pos4;
-    e = 1;
-    while (e > 0) {
-      if (this->chunks.front().data[pos5] == '[') {
-        ++e;
-      }
-      if (this->chunks.front().data[pos5] == ']') {
-        --e;
-      }
-      ++pos5;
+    if (json.getUnsigned(view + ".buffer", 0) != 0 || stride != layout.elementSize) {
+      std::print("!!!Accessor {} is not tightly packed in the BIN chunk\n", index);
+      return false;
+    }
+
+    if (layout.offset + layout.count * layout.elementSize > viewEnd || viewEnd > binary().size()) {
+      std::print("!!!Accessor {} runs past its bufferView\n", index);
+      return false;
     }
 
-    std::string s4(s.begin() + pos4, s.begin() + pos5);
-    std::print("{}\n", s4);
+    return true;
+  }
 
-    std::vector<std::string> v = {};
-    int i = 0;
-    int byteOffset = 0;
-    std::print("{}\n", s4[i]);
+  int64_t glTFmodel::attribute(size_t mesh, size_t primitive, const std::string &name) const {
+    std::string path = "meshes." + std::to_string(mesh) + ".primitives." + std::to_string(primitive) + ".attributes." + name;
+    return json.has(path) ? static_cast<int64_t>(json.getUnsigned(path, 0)) : -1;
+  }
 
-    return vertices;
+  int64_t glTFmodel::indices(size_t mesh, size_t primitive) const {
+    std::string path = "meshes." + std::to_string(mesh) + ".primitives." + std::to_string(primitive) + ".indices";
+    return json.has(path) ? static_cast<int64_t>(json.getUnsigned(path, 0)) : -1;
   }
 } // namespace fileHandler
-/*
-int main() {
-  fileHandler::glTFmodel model("./models/cube.glb");
-  model.info();
-  model.getVertices();
-}*/
@@ -0,0 +1,114 @@
+#include "../include/framePacing.hpp"
+
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+
+namespace framePacing {
+const char* name(LatencyMode mode) {
+  switch(mode) {
+    case LatencyMode::LowLatency:
+      return "low";
+    case LatencyMode::Balanced:
+      return "balanced";
+    case LatencyMode::Throughput:
+      return "throughput";
+  }
+
+  return "unknown";
+}
+
+bool parse(const std::string& text, LatencyMode& mode) {
+  for(LatencyMode candidate : {LatencyMode::LowLatency, LatencyMode::Balanced, LatencyMode::Throughput}) {
+    if(text == name(candidate)) {
+      mode = candidate;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+LatencyMode next(LatencyMode mode) {
+  return static_cast<LatencyMode>((static_cast<int>(mode) + 1) % 3);
+}
+
+uint32_t framesInFlight(LatencyMode mode) {
+  switch(mode) {
+    case LatencyMode::LowLatency:
+      return 1;
+    case LatencyMode::Balanced:
+      return 2;
+    case LatencyMode::Throughput:
+      return 3;
+  }
+
+  return 2;
+}
+
+std::vector<VkPresentModeKHR> presentModes(LatencyMode mode) {
+  switch(mode) {
+    case LatencyMode::LowLatency:
+      return {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR};
+    case LatencyMode::Balanced:
+      return {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR};
+    case LatencyMode::Throughput:
+      return {VK_PRESENT_MODE_FIFO_KHR};
+  }
+
+  return {VK_PRESENT_MODE_FIFO_KHR};
+}
+
+// Deadlines advance by a fixed step so oversleeping one frame does not shift the rest
+void FrameLimiter::wait() {
+  if(fpsCap <= 0.0) {
+    nextFrame = 0;
+    return;
+  }
+
+  Uint64 step = static_cast<Uint64>(1e9 / fpsCap);
+  Uint64 now = SDL_GetTicksNS();
+
+  if(nextFrame == 0 || now > nextFrame + step) {
+    nextFrame = now + step;
+    return;
+  }
+
+  if(now < nextFrame) {
+    SDL_DelayPrecise(nextFrame - now);
+  }
+
+  nextFrame += step;
+}
+
+void LatencyTracker::input(Uint64 timestamp) {
+  if(pendingInput == 0 || timestamp < pendingInput) {
+    pendingInput = timestamp;
+  }
+}
+
+void LatencyTracker::presented(Uint64 timestamp) {
+  if(pendingInput == 0 || timestamp < pendingInput) {
+    return;
+  }
+
+  Uint64 latency = timestamp - pendingInput;
+  sum += latency;
+  maximum = std::max(maximum, latency);
+  ++samples;
+  pendingInput = 0;
+}
+
+double LatencyTracker::averageMs() const {
+  return samples ? static_cast<double>(sum) / samples / 1e6 : 0.0;
+}
+
+double LatencyTracker::maximumMs() const {
+  return static_cast<double>(maximum) / 1e6;
+}
+
+void LatencyTracker::reset() {
+  sum = 0;
+  maximum = 0;
+  samples = 0;
+}
+} // namespace framePacing
@@ -0,0 +1,115 @@
+#include "../include/frameStats.hpp"
+
+#include "../include/config.hpp"
+#include "../include/profiler.hpp"
+#include <SDL3/SDL_log.h>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <fstream>
+
+namespace frameStats {
+size_t Histogram::bucket(uint64_t value) {
+  if(value < 16) {
+    return static_cast<size_t>(value);
+  }
+
+  int shift = std::bit_width(value) - 5;
+  return static_cast<size_t>(shift) * 16 + static_cast<size_t>(value >> shift);
+}
+
+// Middle of the bucket
+uint64_t Histogram::bucketValue(size_t index) {
+  if(index < 32) {
+    return index;
+  }
+
+  int shift = static_cast<int>(index / 16) - 1;
+  return ((index - shift * 16) << shift) + (uint64_t(1) << shift) / 2;
+}
+
+void Histogram::record(uint64_t value) {
+  ++buckets[bucket(value)];
+  ++count;
+  maximum = std::max(maximum, value);
+}
+
+uint64_t Histogram::percentile(double p) const {
+  uint64_t target = static_cast<uint64_t>(p * count);
+  uint64_t seen = 0;
+
+  for(size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+
+    if(seen > target) {
+      return std::min(bucketValue(i), maximum);
+    }
+  }
+
+  return maximum;
+}
+
+void FrameReporter::frame(uint64_t start, uint64_t end) {
+  uint64_t duration = end - start;
+  histogram.record(duration);
+  ++frames;
+
+  // Walking the buckets every frame would blow the budget, the median moves slowly anyway
+  if((frames & 63) == 1) {
+    median = histogram.percentile(0.5);
+  }
+
+  // Zones this thread closed since the last frame
+  const profiler::ThreadBuffer& buffer = profiler::threadBuffer();
+  size_t count = buffer.count.load(std::memory_order_acquire);
+  bool stutter = frames > config::stutterWarmupFrames && duration > median * config::stutterFactor;
+
+  const char* worstZone = nullptr;
+  double worstOver = 0.0;
+
+  for(; zoneCursor < count; ++zoneCursor) {
+    const profiler::Event& event = buffer.at(zoneCursor);
+    if(std::strcmp(event.name, frameZone) == 0) {
+      continue;
+    }
+
+    double ms = (event.end - event.start) / 1e6;
+    auto [it, inserted] = zoneAverages.try_emplace(event.name, ms);
+
+    if(stutter && ms - it->second > worstOver) {
+      worstZone = event.name;
+      worstOver = ms - it->second;
+    }
+
+    it->second += (ms - it->second) * 0.05;
+  }
+
+  if(stutter && stutters.size() < config::maxStutters) {
+    stutters.push_back({frames, duration / 1e6, median / 1e6, worstZone ? worstZone : "unknown", worstOver});
+  }
+}
+
+std::string FrameReporter::report() const {
+  std::string result = std::format("==== frame times ({} frames) ====\n", frames);
+  result += std::format("p50 {:.3f} p95 {:.3f} p99 {:.3f} p99.9 {:.3f} max {:.3f} ms\n",
+    histogram.percentile(0.5) / 1e6, histogram.percentile(0.95) / 1e6, histogram.percentile(0.99) / 1e6, histogram.percentile(0.999) / 1e6, histogram.maximum / 1e6);
+
+  result += std::format("==== stutters ({} over {:.1f}x median) ====\n", stutters.size(), config::stutterFactor);
+  for(const Stutter& stutter : stutters) {
+    result += std::format("frame {}: {:.3f} ms (median {:.3f}), {} ran {:.3f} ms over its average\n", stutter.frame, stutter.ms, stutter.medianMs, stutter.zone, stutter.zoneOverMs);
+  }
+
+  return result;
+}
+
+bool FrameReporter::write(const std::string& path) const {
+  std::ofstream file(path);
+  if(!file) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not open frame report %s\n", path.c_str());
+    return false;
+  }
+
+  file << report();
+  return true;
+}
+} // namespace frameStats
@@ -0,0 +1,31 @@
+#include "../include/game.hpp"
+
+#include "../include/profiler.hpp"
+#include <SDL3/SDL_keyboard.h>
+#include <SDL3/SDL_scancode.h>
+
+namespace game {
+Input keyboard() {
+  const bool* keys = SDL_GetKeyboardState(nullptr);
+
+  Input input;
+  input.forward = static_cast<float>(keys[SDL_SCANCODE_W]) - static_cast<float>(keys[SDL_SCANCODE_S]);
+  input.right = static_cast<float>(keys[SDL_SCANCODE_D]) - static_cast<float>(keys[SDL_SCANCODE_A]);
+  input.up = static_cast<float>(keys[SDL_SCANCODE_SPACE]) - static_cast<float>(keys[SDL_SCANCODE_LSHIFT]);
+  return input;
+}
+
+// Walking turns up into a jump, flying moves along it
+void frame(RenderBackend& renderer, Player& player, Terrain& terrain, const Input& input, float dt) {
+  PROFILE_ZONE("game::frame");
+  player.turn(input.dx, input.dy);
+
+  if(player.flying) {
+    player.move(input.forward, input.right, input.up, dt);
+  } else {
+    player.walk(terrain, input.forward, input.right, input.up > 0.0f, dt);
+  }
+
+  renderer.drawFrame(&player, terrain);
+}
+} // namespace game
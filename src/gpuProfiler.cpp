@@ -0,0 +1,209 @@
+#include "../include/gpuProfiler.hpp"
+
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <format>
+
+void RollingStat::push(double value) {
+  samples[next] = value;
+  next = (next + 1) % samples.size();
+  count = std::min(count + 1, samples.size());
+}
+
+double RollingStat::average() const {
+  double sum = 0.0;
+  for(size_t i = 0; i < count; ++i) {
+    sum += samples[i];
+  }
+
+  return count ? sum / count : 0.0;
+}
+
+double RollingStat::minimum() const {
+  return count ? *std::min_element(samples.begin(), samples.begin() + count) : 0.0;
+}
+
+double RollingStat::maximum() const {
+  return count ? *std::max_element(samples.begin(), samples.begin() + count) : 0.0;
+}
+
+double RollingStat::latest() const {
+  return count ? samples[(next + samples.size() - 1) % samples.size()] : 0.0;
+}
+
+void GpuProfiler::create(VkDevice device, const VkPhysicalDeviceProperties& properties, const VkPhysicalDeviceFeatures& features, uint32_t frames, uint32_t maxGroups, uint32_t maxPipelines) {
+  this->device = device;
+  this->timestampPeriod = properties.limits.timestampPeriod;
+  this->maxGroups = maxGroups;
+  this->maxPipelines = maxPipelines;
+  this->queriesPerFrame = FixedQueries + maxGroups * maxPipelines * 2;
+  this->written.assign(frames, false);
+  this->pipelines.assign(maxPipelines, RollingStat());
+
+  if(!properties.limits.timestampComputeAndGraphics) {
+    SDL_Log("Device has no graphics timestamps, GPU frame times are unavailable");
+  } else {
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = queriesPerFrame * frames;
+
+    if(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create timestamp query pool\n");
+      timestampPool = VK_NULL_HANDLE;
+    }
+  }
+
+  // Chunks are drawn from secondary buffers, so the query has to be inherited
+  if(!features.pipelineStatisticsQuery || !features.inheritedQueries) {
+    SDL_Log("Device has no inherited pipeline statistics, shader invocation counts are unavailable");
+    return;
+  }
+
+  statisticFlags = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+  VkQueryPoolCreateInfo queryPoolInfo{};
+  queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  queryPoolInfo.queryCount = frames;
+  queryPoolInfo.pipelineStatistics = statisticFlags;
+
+  if(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &statisticsPool) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create pipeline statistics query pool\n");
+    statisticsPool = VK_NULL_HANDLE;
+    statisticFlags = 0;
+  }
+}
+
+void GpuProfiler::destroy() {
+  if(timestampPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, timestampPool, nullptr);
+  }
+
+  if(statisticsPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, statisticsPool, nullptr);
+  }
+}
+
+bool GpuProfiler::hasTimestamps() const {
+  return timestampPool != VK_NULL_HANDLE;
+}
+
+bool GpuProfiler::hasStatistics() const {
+  return statisticsPool != VK_NULL_HANDLE;
+}
+
+uint32_t GpuProfiler::pipelineQuery(uint32_t frame, uint32_t group, uint32_t pipeline) const {
+  return frame * queriesPerFrame + FixedQueries + (group * maxPipelines + pipeline) * 2;
+}
+
+void GpuProfiler::reset(VkCommandBuffer commandBuffer, uint32_t frame) {
+  if(hasTimestamps()) {
+    vkCmdResetQueryPool(commandBuffer, timestampPool, frame * queriesPerFrame, queriesPerFrame);
+  }
+
+  if(hasStatistics()) {
+    vkCmdResetQueryPool(commandBuffer, statisticsPool, frame, 1);
+  }
+}
+
+void GpuProfiler::timestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query) {
+  if(hasTimestamps()) {
+    vkCmdWriteTimestamp(commandBuffer, stage, timestampPool, query);
+  }
+}
+
+void GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer, uint32_t frame) {
+  if(hasStatistics()) {
+    vkCmdBeginQuery(commandBuffer, statisticsPool, frame, 0);
+  }
+}
+
+void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer, uint32_t frame) {
+  if(hasStatistics()) {
+    vkCmdEndQuery(commandBuffer, statisticsPool, frame);
+  }
+}
+
+void GpuProfiler::submitted(uint32_t frame) {
+  written[frame] = hasTimestamps() || hasStatistics();
+}
+
+// Groups that were not executed leave their queries unavailable, the availability word filters them out
+bool GpuProfiler::collect(uint32_t frame) {
+  if(!written[frame]) {
+    return false;
+  }
+
+  written[frame] = false;
+  bool frameRead = false;
+
+  if(hasTimestamps()) {
+    std::vector<uint64_t> results(queriesPerFrame * 2);
+    vkGetQueryPoolResults(device, timestampPool, frame * queriesPerFrame, queriesPerFrame, results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    auto elapsed = [&](uint32_t begin, uint32_t end) {
+      if(!results[begin * 2 + 1] || !results[end * 2 + 1]) {
+        return -1.0;
+      }
+
+      return static_cast<double>(results[end * 2] - results[begin * 2]) * timestampPeriod / 1e6;
+    };
+
+    double frameMs = elapsed(FrameBegin, FrameEnd);
+    double passMs = elapsed(PassBegin, PassEnd);
+
+    if(frameMs >= 0.0) {
+      this->frame.push(frameMs);
+      frameRead = true;
+    }
+
+    if(passMs >= 0.0) {
+      renderPass.push(passMs);
+    }
+
+    for(uint32_t p = 0; p < maxPipelines; ++p) {
+      double sum = 0.0;
+
+      for(uint32_t g = 0; g < maxGroups; ++g) {
+        uint32_t query = pipelineQuery(0, g, p);
+        sum += std::max(elapsed(query, query + 1), 0.0);
+      }
+
+      pipelines[p].push(sum);
+    }
+  }
+
+  if(hasStatistics()) {
+    std::array<uint64_t, 3> statistics{};
+    if(vkGetQueryPoolResults(device, statisticsPool, frame, 1, sizeof(statistics), statistics.data(), sizeof(statistics), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) == VK_SUCCESS && statistics[2]) {
+      vertexInvocations.push(static_cast<double>(statistics[0]));
+      fragmentInvocations.push(static_cast<double>(statistics[1]));
+    }
+  }
+
+  return frameRead;
+}
+
+std::string GpuProfiler::report() const {
+  std::string result;
+  auto line = [&](const std::string& name, const RollingStat& stat, const char* unit) {
+    result += std::format("{:>20}: avg {:>10.3f} min {:>10.3f} max {:>10.3f} {}\n", name, stat.average(), stat.minimum(), stat.maximum(), unit);
+  };
+
+  if(hasTimestamps()) {
+    line("frame", frame, "ms");
+    line("render pass", renderPass, "ms");
+
+    for(size_t p = 0; p < pipelines.size(); ++p) {
+      line(std::format("pipeline {}", p), pipelines[p], "ms");
+    }
+  }
+
+  if(hasStatistics()) {
+    line("vertex invocations", vertexInvocations, "");
+    line("fragment invocations", fragmentInvocations, "");
+  }
+
+  return result;
+}
@@ -0,0 +1,58 @@
+#include "../include/meshArena.hpp"
+
+#include <algorithm>
+
+RangeAllocator::RangeAllocator() {
+  this->capacity = 0;
+  this->used = 0;
+  this->freeRanges = {};
+}
+
+RangeAllocator::RangeAllocator(uint32_t capacity) {
+  this->capacity = capacity;
+  this->used = 0;
+  this->freeRanges = {{0, capacity}};
+}
+
+bool RangeAllocator::allocate(uint32_t count, ArenaRange& range) {
+  for(auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+    if(it->count < count) {
+      continue;
+    }
+
+    range = {it->offset, count};
+    it->offset += count;
+    it->count -= count;
+
+    if(it->count == 0) {
+      freeRanges.erase(it);
+    }
+
+    used += count;
+    return true;
+  }
+
+  return false;
+}
+
+void RangeAllocator::free(const ArenaRange& range) {
+  if(range.count == 0) {
+    return;
+  }
+
+  auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), range.offset, [](const ArenaRange& r, uint32_t offset) {
+    return r.offset < offset;
+  });
+  it = freeRanges.insert(it, range);
+  used -= range.count;
+
+  if(it + 1 != freeRanges.end() && it->offset + it->count == (it + 1)->offset) {
+    it->count += (it + 1)->count;
+    freeRanges.erase(it + 1);
+  }
+
+  if(it != freeRanges.begin() && (it - 1)->offset + (it - 1)->count == it->offset) {
+    (it - 1)->count += it->count;
+    freeRanges.erase(it);
+  }
+}
@@ -0,0 +1,91 @@
+#include "../include/nullRenderer.hpp"
+
+#include "../include/config.hpp"
+#include "../include/profiler.hpp"
+#include "../include/vertex.hpp"
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <format>
+
+NullRenderer::NullRenderer(uint32_t width, uint32_t height) {
+  this->width = width;
+  this->height = height;
+}
+
+void NullRenderer::uploadTerrain(Terrain& terrain) {
+  PROFILE_ZONE("NullRenderer::uploadTerrain");
+
+  for(ChunkMesh& mesh : terrain.meshes) {
+    if(mesh.uploaded || mesh.indices.empty()) {
+      continue;
+    }
+
+    uploadedBytes += sizeof(Vertex) * mesh.vertices.size() + sizeof(uint32_t) * mesh.indices.size();
+    mesh.uploaded = true;
+    ++uploads;
+  }
+}
+
+void NullRenderer::releaseChunkMesh(Terrain& terrain, uint32_t chunk) {
+  ChunkMesh& mesh = terrain.meshes[chunk];
+
+  if(mesh.uploaded) {
+    mesh.uploaded = false;
+    ++releases;
+  }
+}
+
+// Same culling and ordering as the Vulkan CPU culling path, the draws are only counted
+void NullRenderer::drawFrame(Player* player, Terrain& terrain) {
+  PROFILE_ZONE("NullRenderer::drawFrame");
+  std::array<calc::Vec4, 6> planes = (player->projection(static_cast<float>(width) / static_cast<float>(height)) * player->rotation() * player->translation()).frustumPlanes();
+
+  terrain.graph.potentiallyVisible(player->x, player->y, player->z, reachableChunks);
+  culling::drawList(terrain, planes, reachableChunks, static_cast<float>(player->x), static_cast<float>(player->y), static_cast<float>(player->z), config::sortChunks ? &chunkSorter : nullptr, visibleChunks);
+
+  for(uint32_t chunk : visibleChunks) {
+    triangles += terrain.meshes[chunk].indices.size() / 3;
+  }
+
+  draws += visibleChunks.size();
+  ++frames;
+  presentedAt = SDL_GetTicksNS();
+}
+
+void NullRenderer::windowResized() {
+}
+
+void NullRenderer::setLatencyMode(framePacing::LatencyMode mode) {
+  latencyMode = mode;
+}
+
+framePacing::LatencyMode NullRenderer::getLatencyMode() const {
+  return latencyMode;
+}
+
+void NullRenderer::setDepthPrepass(bool enabled) {
+  depthPrepass = enabled;
+}
+
+float NullRenderer::getRenderScale() const {
+  return 1.0f;
+}
+
+uint32_t NullRenderer::getMsaaSamples() const {
+  return 1;
+}
+
+double NullRenderer::lastGpuTimeMs() const {
+  return 0.0;
+}
+
+uint64_t NullRenderer::lastPresentNs() const {
+  return presentedAt;
+}
+
+std::string NullRenderer::gpuReport() const {
+  double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+
+  return std::format("null renderer: {} frames, {:.1f} draws and {:.0f} triangles per frame, {} uploads of {:.2f} MiB, {} releases\n",
+    frames, draws * perFrame, triangles * perFrame, uploads, uploadedBytes / (1024.0 * 1024.0), releases);
+}
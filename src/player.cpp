@@ -1,71 +1,119 @@
 #include "../include/player.hpp"
 
 #include "../include/calc.hpp"
+#include "../include/config.hpp"
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_keycode.h>
+#include <algorithm>
 
 #define playerSpeed 5.0f
 #define sensitivity 0.05f
+#define maxTicksPerFrame 5
 
-Player::Player(float x, float y, float z) {
+Player::Player(double x, double y, double z) {
   this->x = x;
   this->y = y;
   this->z = z;
   this->mouseX = 0.0f;
   this->mouseY = 0.0f;
+  this->setFlying(false);
 }
 
 void Player::handleEvent(const SDL_Event& event) {
-  if(event.type == SDL_EVENT_MOUSE_MOTION) {
-    this->mouseX -= event.motion.xrel * sensitivity;
-    this->mouseY -= event.motion.yrel * sensitivity;
-
-    if (this->mouseY > 90.0f)
-      this->mouseY = 90.0f;
-    if (this->mouseY < -90.0f)
-      this->mouseY = -90.0f;
-  }
-
   if(event.type == SDL_EVENT_KEY_DOWN) {
     if(event.key.key == SDLK_P) {
       this->renderType = (this->renderType + 1) % 4;
     }
+
+    if(event.key.key == SDLK_F) {
+      this->setFlying(!this->flying);
+    }
   }
 }
 
-void Player::handleInput(const float& dt) {
-  const bool *key_states = SDL_GetKeyboardState(nullptr);
+void Player::turn(float dx, float dy) {
+  this->mouseX -= dx * sensitivity;
+  this->mouseY -= dy * sensitivity;
+
+  if (this->mouseY > 90.0f)
+    this->mouseY = 90.0f;
+  if (this->mouseY < -90.0f)
+    this->mouseY = -90.0f;
+}
+
+void Player::move(float forward, float right, float up, float dt) {
   float degrees = calc::degrees(this->mouseX);
 
-  if (key_states[SDL_SCANCODE_W]) {
-    this->z -= std::cos(degrees) * playerSpeed * dt;
-    this->x -= std::sin(degrees) * playerSpeed * dt;
-  }
+  this->z -= (std::cos(degrees) * forward + std::sin(degrees) * right) * playerSpeed * dt;
+  this->x -= (std::sin(degrees) * forward - std::cos(degrees) * right) * playerSpeed * dt;
+  this->y += up * playerSpeed * dt;
+}
 
-  if (key_states[SDL_SCANCODE_A]) {
-    this->z += std::sin(degrees) * playerSpeed * dt;
-    this->x -= std::cos(degrees) * playerSpeed * dt;
-  }
+void Player::walk(const Terrain& terrain, float forward, float right, bool jump, float dt) {
+  float degrees = calc::degrees(this->mouseX);
+  float vx = -(std::sin(degrees) * forward - std::cos(degrees) * right) * playerSpeed;
+  float vz = -(std::cos(degrees) * forward + std::sin(degrees) * right) * playerSpeed;
 
-  if (key_states[SDL_SCANCODE_S]) {
-    this->z += std::cos(degrees) * playerSpeed * dt;
-    this->x += std::sin(degrees) * playerSpeed * dt;
-  }
+  // A long frame would owe a burst of ticks, the world slows down for it instead
+  this->tickTime = std::min(this->tickTime + dt, collision::tick * maxTicksPerFrame);
 
-  if (key_states[SDL_SCANCODE_D]) {
-    this->z -= std::sin(degrees) * playerSpeed * dt;
-    this->x += std::cos(degrees) * playerSpeed * dt;
-  }
+  while(this->tickTime >= collision::tick) {
+    this->previousX = this->body.x;
+    this->previousY = this->body.y;
+    this->previousZ = this->body.z;
 
-  if (key_states[SDL_SCANCODE_SPACE]) {
-    this->y += playerSpeed * dt;
-  }
+    this->body.vx = vx;
+    this->body.vz = vz;
+    if(jump && this->body.onGround) {
+      this->body.vy = collision::jumpSpeed;
+    }
 
-  if (key_states[SDL_SCANCODE_LSHIFT]) {
-    this->y -= playerSpeed * dt;
+    collision::step(terrain, this->body, collision::tick);
+    this->tickTime -= collision::tick;
   }
+
+  double alpha = this->tickTime / collision::tick;
+  this->x = this->previousX + (this->body.x - this->previousX) * alpha;
+  this->y = this->previousY + (this->body.y - this->previousY) * alpha + this->eyeHeight;
+  this->z = this->previousZ + (this->body.z - this->previousZ) * alpha;
+}
+
+// Walking starts from wherever the camera is, at rest
+void Player::setFlying(bool flying) {
+  this->flying = flying;
+  this->body.x = this->previousX = this->x;
+  this->body.y = this->previousY = this->y - this->eyeHeight;
+  this->body.z = this->previousZ = this->z;
+  this->body.vx = this->body.vy = this->body.vz = 0.0f;
+  this->body.onGround = false;
+  this->tickTime = 0.0f;
+}
+
+void Player::placeOnGround(const Terrain& terrain) {
+  this->setFlying(this->flying);
+  collision::drop(terrain, this->body);
+
+  this->previousY = this->body.y;
+  this->y = this->body.y + this->eyeHeight;
 }
 
 float Player::getFOV() {
   return this->FOV;
 }
+
+calc::Mat4 Player::rotation() const {
+  return calc::Mat4::MRotationX(calc::degrees(this->mouseY)) * calc::Mat4::MRotationY(calc::degrees(this->mouseX));
+}
+
+calc::Mat4 Player::translation() const {
+  calc::Mat4 translation = calc::Mat4::MIdentity();
+  translation(0, 3) = static_cast<float>(-this->x);
+  translation(1, 3) = static_cast<float>(-this->y);
+  translation(2, 3) = static_cast<float>(-this->z);
+
+  return translation;
+}
+
+calc::Mat4 Player::projection(float aspect) const {
+  return calc::Mat4::perspective(this->FOV, aspect, config::nearPlane, config::farPlane);
+}
@@ -0,0 +1,158 @@
+#include "../include/profiler.hpp"
+
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profiler {
+// Buffers outlive their threads so a trace written at exit still has the workers
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+uint32_t threads = 0;
+
+ThreadBuffer::~ThreadBuffer() {
+  for(std::atomic<Event*>& block : blocks) {
+    delete[] block.load();
+  }
+}
+
+void ThreadBuffer::push(const Event& event) {
+  size_t index = count.load(std::memory_order_relaxed);
+  size_t block = index / blockSize;
+
+  if(block >= maxBlocks) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if(index % blockSize == 0 && blocks[block].load(std::memory_order_relaxed) == nullptr) {
+    blocks[block].store(new Event[blockSize], std::memory_order_release);
+  }
+
+  blocks[block].load(std::memory_order_relaxed)[index % blockSize] = event;
+  count.store(index + 1, std::memory_order_release);
+}
+
+const Event& ThreadBuffer::at(size_t index) const {
+  return blocks[index / blockSize].load(std::memory_order_acquire)[index % blockSize];
+}
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Gives the buffer back when the thread exits
+struct BufferLease {
+  ThreadBuffer* buffer = nullptr;
+
+  ~BufferLease() {
+    if(buffer != nullptr) {
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      buffer->retired = true;
+    }
+  }
+};
+
+ThreadBuffer& threadBuffer() {
+  thread_local BufferLease lease;
+
+  if(lease.buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    auto retired = std::find_if(buffers.begin(), buffers.end(), [](const std::unique_ptr<ThreadBuffer>& buffer) { return buffer->retired; });
+
+    if(retired != buffers.end()) {
+      lease.buffer = retired->get();
+      lease.buffer->retired = false;
+    } else {
+      buffers.push_back(std::make_unique<ThreadBuffer>());
+      lease.buffer = buffers.back().get();
+    }
+
+    // The exited thread's events keep their own track and name
+    uint32_t id = ++threads;
+    lease.buffer->tracks.push_back({id, "thread " + std::to_string(id), lease.buffer->count.load(std::memory_order_relaxed)});
+  }
+
+  return *lease.buffer;
+}
+
+void setThreadName(const std::string& name) {
+  ThreadBuffer& buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  buffer.tracks.back().name = name;
+}
+
+std::string escape(const std::string& text) {
+  std::string result;
+  for(char c : text) {
+    if(c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+
+  return result;
+}
+
+bool writeChromeTrace(const std::string& path) {
+  std::ofstream file(path);
+  if(!file) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not open trace file %s\n", path.c_str());
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  uint64_t origin = UINT64_MAX;
+
+  // Zones are pushed when they end, so the earliest start can be anywhere in a buffer
+  for(const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+    size_t count = buffer->count.load(std::memory_order_acquire);
+    for(size_t i = 0; i < count; ++i) {
+      origin = std::min(origin, buffer->at(i).start);
+    }
+  }
+
+  file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+  bool first = true;
+  size_t events = 0, dropped = 0;
+
+  for(const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+    size_t count = buffer->count.load(std::memory_order_acquire);
+
+    for(size_t t = 0; t < buffer->tracks.size(); ++t) {
+      const Track& track = buffer->tracks[t];
+      size_t end = t + 1 < buffer->tracks.size() ? buffer->tracks[t + 1].firstEvent : count;
+
+      file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track.id << ",\"args\":{\"name\":\"" << escape(track.name) << "\"}}";
+      first = false;
+
+      for(size_t i = track.firstEvent; i < end; ++i) {
+        const Event& event = buffer->at(i);
+        file << ",\n{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track.id
+             << ",\"ts\":" << (event.start - origin) / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << '}';
+      }
+    }
+
+    events += count;
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+
+  file << "\n]}\n";
+  SDL_Log("Trace written to %s: %zu zones on %u threads, %zu dropped", path.c_str(), events, threads, dropped);
+  return true;
+}
+
+Zone::Zone(const char* name) {
+  this->name = name;
+  this->start = now();
+}
+
+Zone::~Zone() {
+  threadBuffer().push({name, start, now()});
+}
+} // namespace profiler
@@ -0,0 +1,101 @@
+#include "../include/renderScale.hpp"
+
+#include "../include/config.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace renderScale {
+uint32_t fewerSamples(uint32_t samples, uint32_t supported) {
+  for(uint32_t count = samples >> 1; count > 0; count >>= 1) {
+    if(supported & count) {
+      return count;
+    }
+  }
+
+  return samples;
+}
+
+uint32_t moreSamples(uint32_t samples, uint32_t supported, uint32_t limit) {
+  for(uint32_t count = samples << 1; count <= limit; count <<= 1) {
+    if(supported & count) {
+      return count;
+    }
+  }
+
+  return samples;
+}
+
+// Scale steps are coarse so the chunk groups are not recorded again for every small drift
+float quantize(float scale) {
+  return std::round(scale / config::renderScaleStep) * config::renderScaleStep;
+}
+
+void Controller::setBudget(double ms, uint32_t maxSamples) {
+  budgetMs = ms;
+  this->maxSamples = maxSamples;
+  sampleCeiling = maxSamples;
+  settle();
+}
+
+Change Controller::update(double gpuMs) {
+  if(budgetMs <= 0.0 || gpuMs <= 0.0) {
+    return Change::None;
+  }
+
+  averageMs = frames == 0 ? gpuMs : averageMs + (gpuMs - averageMs) * config::renderScaleSmoothing;
+  if(++frames < config::renderScaleSettleFrames) {
+    return Change::None;
+  }
+
+  // Pixel cost goes with the square of the scale
+  float target = scale * static_cast<float>(std::sqrt(budgetMs / averageMs));
+
+  if(averageMs > budgetMs * config::renderScaleOverBudget) {
+    uint32_t fewer = fewerSamples(samples, supportedSamples);
+    if(fewer != samples) {
+      samples = fewer;
+      sampleCeiling = fewer;
+      settle();
+      return Change::Samples;
+    }
+
+    float next = std::clamp(quantize(target), scale - config::renderScaleMaxDrop, scale - config::renderScaleStep);
+    next = std::max(next, config::minRenderScale);
+    if(next < scale) {
+      scale = next;
+      settle();
+      return Change::Scale;
+    }
+  } else if(averageMs < budgetMs * config::renderScaleUnderBudget) {
+    if(scale < 1.0f) {
+      scale = std::min(std::clamp(quantize(target), scale + config::renderScaleStep, scale + config::renderScaleMaxRise), 1.0f);
+      settle();
+      return Change::Scale;
+    }
+
+    uint32_t more = moreSamples(samples, supportedSamples, sampleCeiling);
+    if(more != samples) {
+      samples = more;
+      settle();
+      return Change::Samples;
+    }
+
+    // A hitch that lowered the ceiling does not cost MSAA for the rest of the session
+    if(++calmFrames >= config::renderScaleSettleFrames * config::renderScaleCeilingRecovery) {
+      sampleCeiling = moreSamples(sampleCeiling, supportedSamples, maxSamples);
+      calmFrames = 0;
+    }
+
+    return Change::None;
+  }
+
+  calmFrames = 0;
+  return Change::None;
+}
+
+void Controller::settle() {
+  frames = 0;
+  calmFrames = 0;
+  averageMs = 0.0;
+}
+} // namespace renderScale
@@ -10,27 +10,34 @@
 #include <SDL3/SDL_video.h>
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <limits>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 #include "../include/config.hpp"
 #include "../include/calc.hpp"
+#include "../include/profiler.hpp"
+#include "../include/renderScale.hpp"
+#include "../include/taskGraph.hpp"
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
 const float anisotropy = 4.0f;
 
+// The view has no translation, vertices arrive relative to the camera
 struct UniformBufferObject {
-  calc::Mat4 model;
-  calc::Mat4 trans;
-  calc::Mat4 rot;
-  calc::Mat4 proj;
+  calc::Mat4 viewProj;
+  std::array<calc::Vec4, 6> frustum;
+  std::array<int32_t, 4> cameraChunk;
+  calc::Vec4 cameraOffset;
 };
 
 void Renderer::createInstance() {
@@ -43,14 +50,14 @@ void Renderer::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(config::majoranta, config::minoranta, config::patch);
   appInfo.pEngineName = str2.c_str();
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
   createInfo.pApplicationInfo = &appInfo;
 
-  uint32_t extensionsCount;
-  char const* const* extensions = SDL_Vulkan_GetInstanceExtensions(&extensionsCount);
+  uint32_t extensionsCount = 0;
+  char const* const* extensions = headless ? nullptr : SDL_Vulkan_GetInstanceExtensions(&extensionsCount);
 
   createInfo.enabledExtensionCount = extensionsCount;
   createInfo.ppEnabledExtensionNames = extensions;
@@ -62,6 +69,10 @@ void Renderer::createInstance() {
 }
 
 void Renderer::createSurface() {
+  if(headless) {
+    return;
+  }
+
   if(SDL_Vulkan_CreateSurface(window, instance, nullptr, &(this->surface)) == false) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create surface: %s\n", SDL_GetError());
   }
@@ -95,13 +106,18 @@ std::vector<VkDeviceQueueCreateInfo> Renderer::pickPhysicalDevice() {
         currentScore += 10;
         break;
       case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        currentScore += 2;
+        break;
+      // Software rasterizers like lavapipe, only picked when nothing else is there
+      case VK_PHYSICAL_DEVICE_TYPE_CPU:
         currentScore += 1;
         break;
       default:
         continue;
     }
 
-    if(!deviceFeatures.geometryShader || !deviceFeatures.samplerAnisotropy) {
+    // Indirect draws pass the chunk slot through firstInstance
+    if(!deviceFeatures.geometryShader || !deviceFeatures.samplerAnisotropy || !deviceFeatures.drawIndirectFirstInstance) {
       continue;
     }
 
@@ -121,7 +137,11 @@ std::vector<VkDeviceQueueCreateInfo> Renderer::pickPhysicalDevice() {
       }
 
       VkBool32 presentSupport = false;
-      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+      if(headless) {
+        presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+      } else {
+        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+      }
 
       if(presentSupport) {
         presentationFamilyIndices = i;
@@ -140,14 +160,17 @@ std::vector<VkDeviceQueueCreateInfo> Renderer::pickPhysicalDevice() {
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions;
+    if(!headless) {
+      requiredExtensions.insert(deviceExtensions.begin(), deviceExtensions.end());
+    }
 
     for(const auto& extension : availableExtensions) {
       requiredExtensions.erase(extension.extensionName);
     }
 
-    bool swapChainAdequate = false;
-    if (requiredExtensions.empty()) {
+    bool swapChainAdequate = headless;
+    if (!headless && requiredExtensions.empty()) {
       SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
       swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -158,7 +181,7 @@ std::vector<VkDeviceQueueCreateInfo> Renderer::pickPhysicalDevice() {
       this->deviceFeatures = deviceFeatures;
       this->graphicsFamilyIndices = graphicsFamilyIndices;
       this->presentationFamilyIndices = presentationFamilyIndices;
-      msaaSamples = getMaxUsableSampleCount();
+      maxMsaaSamples = getMaxUsableSampleCount();
       bestScore = currentScore;
     }
   }
@@ -169,6 +192,25 @@ std::vector<VkDeviceQueueCreateInfo> Renderer::pickPhysicalDevice() {
     SDL_Log("GPU: %s", deviceProperties.deviceName);
   }
 
+  if(physicalDevice != VK_NULL_HANDLE && deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+    // A count buffer above one draw needs multi draw as well
+    gpuCulling = allowGpuCulling && features12.drawIndirectCount && deviceFeatures.multiDrawIndirect;
+  }
+
+  SDL_Log("Chunk culling: %s", gpuCulling ? "compute" : "cpu");
+
+  msaaSamples = maxMsaaSamples;
+  scaleController.samples = msaaSamples;
+  scaleController.supportedSamples = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
+
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqieQueueFamilies = {graphicsFamilyIndices, presentationFamilyIndices};
 
@@ -181,7 +223,8 @@ std::vector<VkDeviceQueueCreateInfo> Renderer::pickPhysicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
-  this->deviceFeatures.sampleRateShading = VK_TRUE;
+  // Shading every sample multiplies the fragment cost by the sample count, so it is opt in
+  this->deviceFeatures.sampleRateShading = this->deviceFeatures.sampleRateShading && config::sampleShading;
   this->deviceFeatures.fillModeNonSolid = VK_TRUE;
 
   return queueCreateInfos;
@@ -193,10 +236,18 @@ void Renderer::createLogicalDevice(std::vector<VkDeviceQueueCreateInfo> queueCre
   createInfo.pQueueCreateInfos = queueCreateInfo.data();
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfo.size());
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+  createInfo.enabledExtensionCount = headless ? 0 : static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
   createInfo.enabledLayerCount = 0;
 
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+  features12.drawIndirectCount = gpuCulling;
+
+  if(gpuCulling) {
+    createInfo.pNext = &features12;
+  }
+
   if(vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create logical device\n");
   }
@@ -206,6 +257,11 @@ void Renderer::createLogicalDevice(std::vector<VkDeviceQueueCreateInfo> queueCre
 }
 
 void Renderer::createSwapChain() {
+  if(headless) {
+    createOffscreenImages();
+    return;
+  }
+
   SwapChainSupportDetails swapChainSupport = Renderer::querySwapChainSupport(physicalDevice, surface);
 
   VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -228,7 +284,11 @@ void Renderer::createSwapChain() {
   createInfo.imageColorSpace = surfaceFormat.colorSpace;
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
-  createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  createInfo.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+  if(!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not blit to swapchain images\n");
+  }
 
   uint32_t queueFamilyIndices[] = {graphicsFamilyIndices, presentationFamilyIndices};
 
@@ -258,24 +318,30 @@ void Renderer::createSwapChain() {
   swapChainExtent = extent;
 }
 
-void Renderer::createImageViews() {
-  swapChainImageViews.resize(swapChainImages.size());
+// One target per frame slot, they stay in transfer source layout between frames so they can be read back
+void Renderer::createOffscreenImages() {
+  swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+  offscreenImagesMemory.resize(MAX_FRAMES_IN_FLIGHT);
 
-  for (uint32_t i = 0; i < swapChainImages.size(); i++) {
-    swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+  for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    createImage(swapChainExtent.width, swapChainExtent.height, 1, 1, VK_SAMPLE_COUNT_1_BIT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImagesMemory[i]);
   }
 }
 
 void Renderer::createRenderPass() {
+  // Without MSAA the scene image is drawn to directly, otherwise it is the resolve target
+  bool resolve = msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
   VkAttachmentDescription colorAttachment{};
   colorAttachment.format = swapChainImageFormat;
   colorAttachment.samples = msaaSamples;
   colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.storeOp = resolve ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.finalLayout = resolve ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
   VkAttachmentReference colorAttachmentRef{};
   colorAttachmentRef.attachment = 0;
@@ -303,7 +369,7 @@ void Renderer::createRenderPass() {
   colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
   VkAttachmentReference colorAttachmentResolveRef{};
   colorAttachmentResolveRef.attachment = 2;
@@ -314,25 +380,37 @@ void Renderer::createRenderPass() {
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &colorAttachmentRef;
   subpass.pDepthStencilAttachment = &depthAttachmentRef;
-  subpass.pResolveAttachments = &colorAttachmentResolveRef;
-
-  VkSubpassDependency dependency{};
-  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.dstSubpass = 0;
-  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-  dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  subpass.pResolveAttachments = resolve ? &colorAttachmentResolveRef : nullptr;
+
+  // The previous frame's upscale reads the scene image before this pass may write it again
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  std::vector<VkAttachmentDescription> attachments = {colorAttachment, depthAttachment};
+  if(resolve) {
+    attachments.push_back(colorAttachmentResolve);
+  }
 
-  std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
 
   if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create render pass\n");
@@ -353,7 +431,13 @@ void Renderer::createDescriptorSetLayout() {
   samplerLayoutBinding.pImmutableSamplers = nullptr;
   samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+  VkDescriptorSetLayoutBinding originLayoutBinding{};
+  originLayoutBinding.binding = 2;
+  originLayoutBinding.descriptorCount = 1;
+  originLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  originLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings = {uboLayoutBinding, samplerLayoutBinding, originLayoutBinding};
   VkDescriptorSetLayoutCreateInfo layoutInfo{};
   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
   layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -364,11 +448,90 @@ void Renderer::createDescriptorSetLayout() {
   }
 }
 
+void Renderer::createPipelineCache() {
+  std::vector<char> cacheData;
+  std::ifstream file(config::pipelineCachePath, std::ios::ate | std::ios::binary);
+
+  if(file.is_open()) {
+    cacheData.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(cacheData.data(), cacheData.size());
+  }
+
+  // A cache from another driver or GPU is thrown away instead of handed to the driver
+  VkPipelineCacheHeaderVersionOne header{};
+  if(cacheData.size() >= sizeof(header)) {
+    memcpy(&header, cacheData.data(), sizeof(header));
+  }
+
+  pipelineCacheWarm = cacheData.size() >= sizeof(header)
+    && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+    && header.vendorID == deviceProperties.vendorID
+    && header.deviceID == deviceProperties.deviceID
+    && memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+  if(!cacheData.empty() && !pipelineCacheWarm) {
+    SDL_Log("Pipeline cache does not match this device, starting cold");
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = pipelineCacheWarm ? cacheData.size() : 0;
+  cacheInfo.pInitialData = pipelineCacheWarm ? cacheData.data() : nullptr;
+
+  if(vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create pipeline cache\n");
+  }
+}
+
+void Renderer::savePipelineCache() {
+  size_t size = 0;
+  if(vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+    return;
+  }
+
+  std::vector<char> cacheData(size);
+  if(vkGetPipelineCacheData(device, pipelineCache, &size, cacheData.data()) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read pipeline cache\n");
+    return;
+  }
+
+  std::ofstream file(config::pipelineCachePath, std::ios::binary | std::ios::trunc);
+  if(!file.is_open()) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not write pipeline cache\n");
+    return;
+  }
+
+  file.write(cacheData.data(), size);
+}
+
 void Renderer::createGraphicalPipeline() {
-  std::pair<VkPipelineLayout, VkPipeline> p1 = createPipeline("../shaders/vert.spv", "../shaders/frag.spv", VK_POLYGON_MODE_FILL);
-  std::pair<VkPipelineLayout, VkPipeline> p2 = createPipeline("../shaders/vert.spv", "../shaders/flat.frag.spv", VK_POLYGON_MODE_FILL);
-  std::pair<VkPipelineLayout, VkPipeline> p3 = createPipeline("../shaders/vert.spv", "../shaders/black.frag.spv", VK_POLYGON_MODE_LINE);
-  std::pair<VkPipelineLayout, VkPipeline> p4 = createPipeline("../shaders/normal.vert.spv", "../shaders/normal.frag.spv", VK_POLYGON_MODE_FILL);
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  // Modules are made here on one thread, the workers only get the handles
+  VkShaderModule vert = loadShaderModule("shaders/vert.spv");
+  VkShaderModule frag = loadShaderModule("shaders/frag.spv");
+  VkShaderModule flatFrag = loadShaderModule("shaders/flat.frag.spv");
+  VkShaderModule blackFrag = loadShaderModule("shaders/black.frag.spv");
+  VkShaderModule normalVert = loadShaderModule("shaders/normal.vert.spv");
+  VkShaderModule normalFrag = loadShaderModule("shaders/normal.frag.spv");
+  VkShaderModule modelVert = loadShaderModule("shaders/model.vert.spv");
+
+  std::future<std::pair<VkPipelineLayout, VkPipeline>> f1 = std::async(std::launch::async, &Renderer::createPipeline, this, vert, frag, VK_POLYGON_MODE_FILL, VertexInput::Chunk);
+  std::future<std::pair<VkPipelineLayout, VkPipeline>> f2 = std::async(std::launch::async, &Renderer::createPipeline, this, vert, flatFrag, VK_POLYGON_MODE_FILL, VertexInput::Chunk);
+  std::future<std::pair<VkPipelineLayout, VkPipeline>> f3 = std::async(std::launch::async, &Renderer::createPipeline, this, vert, blackFrag, VK_POLYGON_MODE_LINE, VertexInput::Chunk);
+  std::future<std::pair<VkPipelineLayout, VkPipeline>> f4 = std::async(std::launch::async, &Renderer::createPipeline, this, normalVert, normalFrag, VK_POLYGON_MODE_FILL, VertexInput::Chunk);
+  std::future<std::pair<VkPipelineLayout, VkPipeline>> f5 = std::async(std::launch::async, &Renderer::createPipeline, this, vert, VK_NULL_HANDLE, VK_POLYGON_MODE_FILL, VertexInput::Chunk);
+  std::future<std::pair<VkPipelineLayout, VkPipeline>> f6 = std::async(std::launch::async, &Renderer::createPipeline, this, modelVert, frag, VK_POLYGON_MODE_FILL, VertexInput::Model);
+
+  std::pair<VkPipelineLayout, VkPipeline> p1 = f1.get();
+  std::pair<VkPipelineLayout, VkPipeline> p2 = f2.get();
+  std::pair<VkPipelineLayout, VkPipeline> p3 = f3.get();
+  std::pair<VkPipelineLayout, VkPipeline> p4 = f4.get();
+  std::tie(depthPipelineLayout, depthPipeline) = f5.get();
+  std::tie(modelPipelineLayout, modelPipeline) = f6.get();
+
+  SDL_Log("Graphics pipelines: %.2f ms", static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
 
   pipelineLayout[0].push_back(p1.first);
   pipelineLayout[1].push_back(p2.first);
@@ -382,29 +545,137 @@ void Renderer::createGraphicalPipeline() {
   graphicsPipeline[3].push_back(p4.second);
 }
 
+// Render types share pipelines, so every handle is destroyed once
+void Renderer::destroyGraphicalPipelines() {
+  std::set<VkPipeline> pipelines;
+  std::set<VkPipelineLayout> layouts;
+
+  for(std::vector<VkPipeline>& renderType : graphicsPipeline) {
+    pipelines.insert(renderType.begin(), renderType.end());
+    renderType.clear();
+  }
+
+  for(std::vector<VkPipelineLayout>& renderType : pipelineLayout) {
+    layouts.insert(renderType.begin(), renderType.end());
+    renderType.clear();
+  }
+
+  for(VkPipeline pipeline : pipelines) {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+
+  for(VkPipelineLayout layout : layouts) {
+    vkDestroyPipelineLayout(device, layout, nullptr);
+  }
+
+  vkDestroyPipeline(device, depthPipeline, nullptr);
+  vkDestroyPipelineLayout(device, depthPipelineLayout, nullptr);
+  vkDestroyPipeline(device, modelPipeline, nullptr);
+  vkDestroyPipelineLayout(device, modelPipelineLayout, nullptr);
+}
+
+void Renderer::createCullPipeline() {
+  if(!gpuCulling) {
+    return;
+  }
+
+  // 0 is the frame uniform buffer, then bounds, draw records, culled draws, the draw count and reachable flags
+  std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
+  for(uint32_t i = 0; i < bindings.size(); ++i) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create cull descriptor set layout\n");
+  }
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create cull pipeline layout\n");
+  }
+
+  VkShaderModule computeShaderModule = loadShaderModule("shaders/cull.comp.spv");
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = computeShaderModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = cullPipelineLayout;
+
+  if(vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create cull pipeline\n");
+  }
+}
+
 void Renderer::createFramebuffers() {
-  swapChainFramebuffers.resize(swapChainImageViews.size());
+  std::vector<VkImageView> attachments = {sceneImageView, depthImageView};
+  if(msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+    attachments = {colorImageView, depthImageView, sceneImageView};
+  }
 
-  for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-    std::array<VkImageView, 3> attachments = {
-      colorImageView,
-      depthImageView,
-      swapChainImageViews[i]
-    };
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebufferInfo.pAttachments = attachments.data();
+  framebufferInfo.width = swapChainExtent.width;
+  framebufferInfo.height = swapChainExtent.height;
+  framebufferInfo.layers = 1;
+
+  if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &sceneFramebuffer) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create framebuffer\n");
+  }
+}
 
-    VkFramebufferCreateInfo framebufferInfo{};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = renderPass;
-    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    framebufferInfo.pAttachments = attachments.data();
-    framebufferInfo.width = swapChainExtent.width;
-    framebufferInfo.height = swapChainExtent.height;
-    framebufferInfo.layers = 1;
-
-    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
-      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create framebuffer\n");
-    }
+// Attachments are made at full size, lower scales only render into part of them
+void Renderer::createRenderTargets() {
+  if(msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+    createColorResource();
+  }
+
+  createDepthResources();
+  createSceneImage();
+  createFramebuffers();
+  updateRenderExtent();
+}
+
+void Renderer::cleanupRenderTargets() {
+  if(msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+    vkDestroyImageView(device, colorImageView, nullptr);
+    vkDestroyImage(device, colorImage, nullptr);
+    vkFreeMemory(device, colorImageMemory, nullptr);
   }
+
+  vkDestroyImageView(device, depthImageView, nullptr);
+  vkDestroyImage(device, depthImage, nullptr);
+  vkFreeMemory(device, depthImageMemory, nullptr);
+
+  vkDestroyImageView(device, sceneImageView, nullptr);
+  vkDestroyImage(device, sceneImage, nullptr);
+  vkFreeMemory(device, sceneImageMemory, nullptr);
+
+  vkDestroyFramebuffer(device, sceneFramebuffer, nullptr);
 }
 
 void Renderer::createCommandPool() {
@@ -418,6 +689,26 @@ void Renderer::createCommandPool() {
   }
 }
 
+// Pools are not thread safe, so every recording thread gets its own
+void Renderer::createWorkerCommandPools() {
+  uint32_t workerCount = std::clamp(std::thread::hardware_concurrency(), 1u, config::maxRecordThreads);
+  workerCommandPools.resize(workerCount);
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = graphicsFamilyIndices;
+
+  for(VkCommandPool& pool : workerCommandPools) {
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create worker command pool\n");
+    }
+  }
+
+  // Started once, a re-record only hands the threads their groups
+  recordWorkers = std::make_unique<taskGraph::TaskGraph>(workerCount);
+}
+
 uint32_t Renderer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -435,55 +726,124 @@ uint32_t Renderer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pro
 void Renderer::createColorResource() {
   VkFormat colorFormat = swapChainImageFormat;
 
-  createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
-  colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+  createImage(swapChainExtent.width, swapChainExtent.height, 1, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
+  colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, 1, 1);
 }
 
 void Renderer::createDepthResources() {
   VkFormat depthFormat = findDepthFormat();
 
-  createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
-  depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+  createImage(swapChainExtent.width, swapChainExtent.height, 1, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+  depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, 1, 1);
 
-  transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+  transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1, 1);
 }
 
-void Renderer::createTextureImage() {
-  SDL_Surface* surface = SDL_LoadPNG("../textures/tex.png");
-  SDL_Surface* converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
-  SDL_DestroySurface(surface);
+void Renderer::createSceneImage() {
+  createImage(swapChainExtent.width, swapChainExtent.height, 1, 1, VK_SAMPLE_COUNT_1_BIT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sceneImage, sceneImageMemory);
+  sceneImageView = createImageView(sceneImage, swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, 1, 1);
+
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, swapChainImageFormat, &formatProperties);
+  upscaleFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+}
+
+// The CPU half of the texture, it only reads the physical device so it can run next to the rest of the init
+void Renderer::decodeTextureImage() {
+  const VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+  pendingTexture.blit = (formatProperties.optimalTilingFeatures & (VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) == (VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+
+  // Packed textures are already decoded and mipmapped, loose ones only get their levels here when the GPU cannot blit them
+  const assetPack::Entry* packed = assets.find(assetPack::blockTextures);
 
-  if(converted == nullptr) {
-    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not load image\n");
+  if(packed != nullptr && packed->kind == assetPack::Kind::Texture) {
+    pendingTexture.width = packed->width;
+    pendingTexture.height = packed->height;
+    pendingTexture.layers = packed->layers;
+    pendingTexture.mipLevels = packed->mipLevels;
+    pendingTexture.pixels = assets.bytes(*packed);
+    return;
+  }
+
+  if(!pendingTexture.blit) {
+    SDL_Log("Texture format cannot be blitted with linear filtering, generating mipmaps on the CPU");
   }
 
-  int imageWidth = converted->w, imageHeight = converted->h;
-  VkDeviceSize imageSize = converted->w * converted->h * 4;
+  std::vector<std::string> paths;
+  for(const std::string& layer : config::textureLayers) {
+    paths.push_back(config::assetRoot + layer);
+  }
+
+  pendingTexture.decoded = assetPack::decodeTextures(paths, !pendingTexture.blit);
+  pendingTexture.width = pendingTexture.decoded.width;
+  pendingTexture.height = pendingTexture.decoded.height;
+  pendingTexture.layers = pendingTexture.decoded.layers;
+  pendingTexture.mipLevels = pendingTexture.decoded.mipLevels;
+  pendingTexture.pixels = pendingTexture.decoded.pixels;
+}
 
+void Renderer::createTextureImage() {
+  PROFILE_ZONE("create texture image");
+  const VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+  uint32_t imageWidth = pendingTexture.width, imageHeight = pendingTexture.height, givenLevels = pendingTexture.mipLevels;
+  std::span<const unsigned char> pixels = pendingTexture.pixels;
+  textureLayers = pendingTexture.layers;
+
+  textureMipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(imageWidth, imageHeight)))) + 1;
+  if(givenLevels < textureMipLevels && !pendingTexture.blit) {
+    textureMipLevels = givenLevels;
+  }
+
+  std::vector<VkBufferImageCopy> regions;
+  VkDeviceSize regionOffset = 0;
+  for(uint32_t layer = 0; layer < textureLayers; ++layer) {
+    for(uint32_t level = 0; level < givenLevels; ++level) {
+      if(level < textureMipLevels) {
+        VkBufferImageCopy region{};
+        region.bufferOffset = regionOffset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = layer;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {std::max(imageWidth >> level, 1u), std::max(imageHeight >> level, 1u), 1};
+        regions.push_back(region);
+      }
+
+      regionOffset += assetPack::levelSize(imageWidth, imageHeight, level);
+    }
+  }
+
+  VkDeviceSize imageSize = pixels.size();
   VkBuffer buffer;
   VkDeviceMemory stagingBufferMemory;
   createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, buffer, stagingBufferMemory);
 
   void* data;
   vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-  memcpy(data, converted->pixels, static_cast<size_t>(imageSize));
+  memcpy(data, pixels.data(), pixels.size());
   vkUnmapMemory(device, stagingBufferMemory);
 
-  SDL_DestroySurface(converted);
-
-  createImage(imageWidth, imageHeight, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+  createImage(imageWidth, imageHeight, textureMipLevels, textureLayers, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  copyBufferToImage(buffer, textureImage, static_cast<uint32_t>(imageWidth), static_cast<uint32_t>(imageHeight));
+  transitionImageLayout(textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, textureMipLevels, textureLayers);
+  copyBufferToImage(buffer, textureImage, regions);
 
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  if(givenLevels < textureMipLevels) {
+    generateMipmaps(textureImage, format, imageWidth, imageHeight, textureMipLevels, textureLayers);
+  } else {
+    transitionImageLayout(textureImage, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, textureMipLevels, textureLayers);
+  }
 
   vkDestroyBuffer(device, buffer, nullptr);
   vkFreeMemory(device, stagingBufferMemory, nullptr);
+  pendingTexture = {};
 }
 
 void Renderer::createTextureImageView() {
-  textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+  textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D_ARRAY, textureMipLevels, textureLayers);
 }
 
 void Renderer::createTextureSampler() {
@@ -503,78 +863,467 @@ void Renderer::createTextureSampler() {
   samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
   samplerInfo.mipLodBias = 0.0f;
   samplerInfo.minLod = 0.0f;
-  samplerInfo.maxLod = 0.0f;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
   if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create texture sampler\n");
   }
 }
 
-void Renderer::createVertexBuffer(const std::vector<Vertex>& vertices, VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory) {
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+void Renderer::createUniformBuffers() {
+  VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+  uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+  uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
-  void* data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-  vkUnmapMemory(device, stagingBufferMemory);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+    vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+  }
+}
 
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+void Renderer::createMeshArena() {
+  createBuffer(sizeof(Vertex) * static_cast<VkDeviceSize>(config::arenaVertexCapacity), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshArena.vertexBuffer, meshArena.vertexBufferMemory);
+  createBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(config::arenaIndexCapacity), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshArena.indexBuffer, meshArena.indexBufferMemory);
 
-  copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+  meshArena.vertices = RangeAllocator(config::arenaVertexCapacity);
+  meshArena.indices = RangeAllocator(config::arenaIndexCapacity);
+}
 
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
+void Renderer::createIndirectBuffers() {
+  VkDeviceSize bufferSize = sizeof(VkDrawIndexedIndirectCommand) * config::maxChunkDraws;
+
+  indirectBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  indirectBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+  indirectBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    createBuffer(bufferSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indirectBuffers[i], indirectBuffersMemory[i]);
+    vkMapMemory(device, indirectBuffersMemory[i], 0, bufferSize, 0, &indirectBuffersMapped[i]);
+  }
+}
+
+void Renderer::createChunkOriginBuffer() {
+  createBuffer(sizeof(std::array<int32_t, 4>) * config::maxChunkDraws, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, chunkOriginBuffer, chunkOriginBufferMemory);
+}
+
+void Renderer::createCullingResources() {
+  if(!gpuCulling) {
+    return;
+  }
+
+  createBuffer(sizeof(calc::Vec4) * 2 * config::maxChunkDraws, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, chunkBoundsBuffer, chunkBoundsBufferMemory);
+  createBuffer(sizeof(VkDrawIndexedIndirectCommand) * config::maxChunkDraws, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, chunkDrawsBuffer, chunkDrawsBufferMemory);
+
+  culledDrawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  culledDrawBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+  drawCountBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  drawCountBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+  reachableBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  reachableBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+  reachableBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    createBuffer(sizeof(VkDrawIndexedIndirectCommand) * config::maxChunkDraws, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, culledDrawBuffers[i], culledDrawBuffersMemory[i]);
+    createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawCountBuffers[i], drawCountBuffersMemory[i]);
+    createBuffer(sizeof(uint32_t) * config::maxChunkDraws, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, reachableBuffers[i], reachableBuffersMemory[i]);
+    vkMapMemory(device, reachableBuffersMemory[i], 0, sizeof(uint32_t) * config::maxChunkDraws, 0, &reachableBuffersMapped[i]);
+  }
+}
+
+void Renderer::uploadTerrain(Terrain& terrain) {
+  PROFILE_ZONE("Renderer::uploadTerrain");
+  VkDeviceSize vertexBytes = 0, indexBytes = 0;
+
+  updateChunkGroups(std::min(static_cast<uint32_t>(terrain.meshes.size()), config::maxChunkDraws));
+
+  // Chunks that do not fit are skipped and tried again by the next upload, the ones before them still go up
+  std::vector<ChunkMesh*> placed;
+  uint32_t skipped = 0;
+
+  for(ChunkMesh& mesh : terrain.meshes) {
+    if(mesh.uploaded || mesh.indices.empty()) {
+      continue;
+    }
+
+    if(!meshArena.vertices.allocate(static_cast<uint32_t>(mesh.vertices.size()), mesh.vertexRange)) {
+      mesh.vertexRange = {};
+      ++skipped;
+      continue;
+    }
+
+    if(!meshArena.indices.allocate(static_cast<uint32_t>(mesh.indices.size()), mesh.indexRange)) {
+      meshArena.vertices.free(mesh.vertexRange);
+      mesh.vertexRange = {};
+      mesh.indexRange = {};
+      ++skipped;
+      continue;
+    }
+
+    placed.push_back(&mesh);
+    vertexBytes += sizeof(Vertex) * mesh.vertices.size();
+    indexBytes += sizeof(uint32_t) * mesh.indices.size();
+  }
+
+  if(skipped > 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Mesh arena is out of space, %u chunks were not uploaded\n", skipped);
+  }
+
+  if(vertexBytes + indexBytes == 0) {
+    return;
+  }
+
+  char* data = stageUpload(vertexBytes + indexBytes);
+  VkDeviceSize vertexOffset = 0, indexOffset = vertexBytes;
+
+  for(ChunkMesh* placedMesh : placed) {
+    ChunkMesh& mesh = *placedMesh;
+    VkDeviceSize size = sizeof(Vertex) * mesh.vertices.size();
+    memcpy(data + vertexOffset, mesh.vertices.data(), static_cast<size_t>(size));
+    stageCopy(meshArena.vertexBuffer, {vertexOffset, sizeof(Vertex) * static_cast<VkDeviceSize>(mesh.vertexRange.offset), size});
+    vertexOffset += size;
+
+    size = sizeof(uint32_t) * mesh.indices.size();
+    memcpy(data + indexOffset, mesh.indices.data(), static_cast<size_t>(size));
+    stageCopy(meshArena.indexBuffer, {indexOffset, sizeof(uint32_t) * static_cast<VkDeviceSize>(mesh.indexRange.offset), size});
+    indexOffset += size;
+
+    mesh.uploaded = true;
+  }
+
+  uploadChunkOrigins(terrain);
+  uploadChunkRecords(terrain);
+}
+
+int32_t Renderer::loadModel(const std::string& path) {
+  PROFILE_ZONE("Renderer::loadModel");
+  const assetPack::Entry* entry = assets.find(path);
+  fileHandler::glTFmodel source = entry ? fileHandler::glTFmodel(assets.bytes(*entry)) : fileHandler::glTFmodel(config::assetRoot + path);
+  GpuModel model;
+
+  if(!source.isValid() || !uploadModel(source, model)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not load model %s\n", path.c_str());
+    return -1;
+  }
+
+  models.push_back(std::move(model));
+  return static_cast<int32_t>(models.size() - 1);
 }
 
-void Renderer::createIndexBuffer(const std::vector<uint32_t>& indices, VkBuffer& indexBuffer, VkDeviceMemory& indexBufferMemory) {
-  VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+bool Renderer::uploadModel(const fileHandler::glTFmodel& source, GpuModel& target) {
+  struct Vec3 { float x, y, z; };
+  struct Vec2 { float u, v; };
+
+  int64_t positionAccessor = source.attribute(0, 0, "POSITION");
+  int64_t normalAccessor = source.attribute(0, 0, "NORMAL");
+  int64_t texCoordAccessor = source.attribute(0, 0, "TEXCOORD_0");
+  int64_t indexAccessor = source.indices(0, 0);
+
+  if(positionAccessor < 0 || indexAccessor < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not find positions and indices of the first primitive\n");
+    return false;
+  }
+
+  // Spans over the mapped BIN chunk, the only copy before the GPU is the one into staging
+  std::span<const Vec3> positions = source.accessor<Vec3>(positionAccessor);
+  std::span<const Vec3> normals = normalAccessor < 0 ? std::span<const Vec3>() : source.accessor<Vec3>(normalAccessor);
+  std::span<const Vec2> texCoords = texCoordAccessor < 0 ? std::span<const Vec2>() : source.accessor<Vec2>(texCoordAccessor);
+  std::span<const unsigned char> indices;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+
+  fileHandler::AccessorLayout indexLayout;
+  if(source.accessorLayout(indexAccessor, indexLayout) && indexLayout.componentType == fileHandler::componentType::UNSIGNED_INT) {
+    std::span<const uint32_t> ints = source.accessor<uint32_t>(indexAccessor);
+    indices = {reinterpret_cast<const unsigned char*>(ints.data()), ints.size_bytes()};
+    indexType = VK_INDEX_TYPE_UINT32;
+  } else if(indexLayout.componentType == fileHandler::componentType::UNSIGNED_SHORT) {
+    std::span<const uint16_t> shorts = source.accessor<uint16_t>(indexAccessor);
+    indices = {reinterpret_cast<const unsigned char*>(shorts.data()), shorts.size_bytes()};
+  }
+
+  if(positions.empty() || indices.empty() || (!normals.empty() && normals.size() != positions.size()) || (!texCoords.empty() && texCoords.size() != positions.size())) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not use the model's accessors, they need tight float attributes and uint16 or uint32 indices\n");
+    return false;
+  }
+
+  // Vertex and index bindings only need their element alignment, 16 keeps every stream on a nice boundary
+  auto align = [](VkDeviceSize offset) { return (offset + 15) & ~VkDeviceSize(15); };
+  // Every stream has one element per vertex, missing ones are zero filled so each binding reads its own data
+  target.positionOffset = 0;
+  target.normalOffset = align(positions.size_bytes());
+  target.texCoordOffset = align(target.normalOffset + sizeof(Vec3) * positions.size());
+  target.indexOffset = align(target.texCoordOffset + sizeof(Vec2) * positions.size());
+  target.vertexCount = static_cast<uint32_t>(positions.size());
+  target.indexCount = static_cast<uint32_t>(indices.size() / (indexType == VK_INDEX_TYPE_UINT32 ? sizeof(uint32_t) : sizeof(uint16_t)));
+  target.indexType = indexType;
+  VkDeviceSize bufferSize = target.indexOffset + indices.size();
 
   VkBuffer stagingBuffer;
   VkDeviceMemory stagingBufferMemory;
   createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
-  void* data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
+  char* data;
+  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, reinterpret_cast<void**>(&data));
+  memcpy(data + target.positionOffset, positions.data(), positions.size_bytes());
+  memset(data + target.normalOffset, 0, target.indexOffset - target.normalOffset);
+  if(!normals.empty()) {
+    memcpy(data + target.normalOffset, normals.data(), normals.size_bytes());
+  }
+  if(!texCoords.empty()) {
+    memcpy(data + target.texCoordOffset, texCoords.data(), texCoords.size_bytes());
+  }
+  memcpy(data + target.indexOffset, indices.data(), indices.size());
   vkUnmapMemory(device, stagingBufferMemory);
 
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+  if(target.buffer != VK_NULL_HANDLE) {
+    releaseModel(target);
+  }
 
-  copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target.buffer, target.memory);
+  copyBuffer(stagingBuffer, target.buffer, bufferSize);
 
   vkDestroyBuffer(device, stagingBuffer, nullptr);
   vkFreeMemory(device, stagingBufferMemory, nullptr);
+  return true;
 }
 
-void Renderer::createUniformBuffers() {
-  VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+void Renderer::releaseModel(GpuModel& target) {
+  releaseBuffer(target.buffer, target.memory);
 
-  uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+  for(size_t i = 0; i < target.instanceBuffers.size(); ++i) {
+    releaseBuffer(target.instanceBuffers[i], target.instanceBuffersMemory[i]);
+  }
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
-    vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+  target = GpuModel{};
+}
+
+void Renderer::setModelInstances(uint32_t model, std::span<const ModelInstance> instances) {
+  if(model >= models.size()) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not set instances of model %u, %zu are loaded\n", model, models.size());
+    return;
+  }
+
+  models[model].instances.assign(instances.begin(), instances.end());
+  ++models[model].instancesVersion;
+}
+
+size_t Renderer::modelCount() const {
+  return models.size();
+}
+
+// Buffers that got too small are replaced in every slot, the old ones wait in the deletion queue for the frames using them
+void Renderer::updateModelInstances(uint32_t frame) {
+  PROFILE_ZONE("Renderer::updateModelInstances");
+
+  for(GpuModel& model : models) {
+    uint32_t count = static_cast<uint32_t>(model.instances.size());
+
+    if(count > model.instanceCapacity) {
+      for(size_t i = 0; i < model.instanceBuffers.size(); ++i) {
+        releaseBuffer(model.instanceBuffers[i], model.instanceBuffersMemory[i]);
+      }
+
+      model.instanceCapacity = std::max(count, model.instanceCapacity * 2);
+      model.instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+      model.instanceBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+      model.instanceBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+      model.uploadedVersion.assign(MAX_FRAMES_IN_FLIGHT, 0);
+
+      VkDeviceSize bufferSize = sizeof(ModelInstance) * static_cast<VkDeviceSize>(model.instanceCapacity);
+      for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, model.instanceBuffers[i], model.instanceBuffersMemory[i]);
+        vkMapMemory(device, model.instanceBuffersMemory[i], 0, bufferSize, 0, &model.instanceBuffersMapped[i]);
+      }
+    }
+
+    if(count > 0 && model.uploadedVersion[frame] != model.instancesVersion) {
+      memcpy(model.instanceBuffersMapped[frame], model.instances.data(), sizeof(ModelInstance) * count);
+      model.uploadedVersion[frame] = model.instancesVersion;
+    }
+  }
+}
+
+// False when no model has instances, then there is nothing to execute
+bool Renderer::recordModels(uint32_t frame) {
+  bool any = false;
+  for(const GpuModel& model : models) {
+    any |= !model.instances.empty();
+  }
+
+  if(!any) {
+    return false;
+  }
+
+  VkCommandBuffer commandBuffer = modelCommandBuffers[frame];
+  beginChunkGroup(commandBuffer);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, modelPipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, modelPipelineLayout, 0, 1, &descriptorSets[frame], 0, nullptr);
+
+  for(const GpuModel& model : models) {
+    if(model.instances.empty()) {
+      continue;
+    }
+
+    VkBuffer vertexBuffers[] = {model.buffer, model.buffer, model.buffer, model.instanceBuffers[frame]};
+    VkDeviceSize offsets[] = {model.positionOffset, model.normalOffset, model.texCoordOffset, 0};
+
+    vkCmdBindVertexBuffers(commandBuffer, 0, 4, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, model.buffer, model.indexOffset, model.indexType);
+    vkCmdDrawIndexed(commandBuffer, model.indexCount, static_cast<uint32_t>(model.instances.size()), 0, 0, 0);
+  }
+
+  vkEndCommandBuffer(commandBuffer);
+  return true;
+}
+
+// Tagged with the frame being recorded, a call between frames waits for one extra fence at worst
+void Renderer::releaseBuffer(VkBuffer buffer, VkDeviceMemory memory) {
+  deletionQueue.buffer(submittedFrames + 1, buffer);
+  deletionQueue.memory(submittedFrames + 1, memory);
+}
+
+void Renderer::releaseChunkMesh(Terrain& terrain, uint32_t chunk) {
+  ChunkMesh& mesh = terrain.meshes[chunk];
+
+  if(!mesh.uploaded) {
+    return;
+  }
+
+  deletionQueue.range(submittedFrames + 1, meshArena.vertices, mesh.vertexRange);
+  deletionQueue.range(submittedFrames + 1, meshArena.indices, mesh.indexRange);
+  mesh.vertexRange = {};
+  mesh.indexRange = {};
+  mesh.uploaded = false;
+
+  // The compute pass reads draw records of its own and would keep drawing the old ranges, the next frame zeroes this one
+  if(gpuCulling && chunk < chunkCount) {
+    releasedChunkRecords.push_back(chunk);
+  }
+}
+
+size_t Renderer::pendingDeletions() const {
+  return deletionQueue.pending.size();
+}
+
+// Origins in whole chunks, draws pick theirs with firstInstance set to the chunk slot
+void Renderer::uploadChunkOrigins(const Terrain& terrain) {
+  uint32_t slots = std::min(static_cast<uint32_t>(terrain.chunks.size()), config::maxChunkDraws);
+
+  if(slots == 0) {
+    return;
+  }
+
+  std::array<int32_t, 4>* origins = reinterpret_cast<std::array<int32_t, 4>*>(stageUpload(sizeof(std::array<int32_t, 4>) * slots));
+
+  for(uint32_t i = 0; i < slots; ++i) {
+    const Chunk& chunk = terrain.chunks[i];
+    origins[i] = {chunk.x >> 4, chunk.y >> 4, chunk.z >> 4, 0};
+  }
+
+  stageCopy(chunkOriginBuffer, {0, 0, sizeof(std::array<int32_t, 4>) * slots});
+}
+
+// Bounds and draw records for every chunk, the compute pass picks the visible ones each frame
+void Renderer::uploadChunkRecords(const Terrain& terrain) {
+  if(!gpuCulling) {
+    return;
+  }
+
+  chunkCount = std::min(static_cast<uint32_t>(terrain.meshes.size()), config::maxChunkDraws);
+
+  // Every record is rewritten, a released chunk that came back must not be zeroed afterwards
+  releasedChunkRecords.clear();
+
+  if(chunkCount == 0) {
+    return;
+  }
+
+  VkDeviceSize boundsBytes = sizeof(calc::Vec4) * 2 * chunkCount;
+  VkDeviceSize drawsBytes = sizeof(VkDrawIndexedIndirectCommand) * chunkCount;
+
+  char* data = stageUpload(boundsBytes + drawsBytes);
+
+  calc::Vec4* boxes = reinterpret_cast<calc::Vec4*>(data);
+  VkDrawIndexedIndirectCommand* draws = reinterpret_cast<VkDrawIndexedIndirectCommand*>(data + boundsBytes);
+
+  for(uint32_t i = 0; i < chunkCount; ++i) {
+    const ChunkMesh& mesh = terrain.meshes[i];
+
+    boxes[2 * i] = calc::Vec4(terrain.bounds.minX[i], terrain.bounds.minY[i], terrain.bounds.minZ[i], 1.0f);
+    boxes[2 * i + 1] = calc::Vec4(terrain.bounds.maxX[i], terrain.bounds.maxY[i], terrain.bounds.maxZ[i], 1.0f);
+
+    // Zero indices marks a chunk the shader skips
+    draws[i].indexCount = mesh.uploaded ? mesh.indexRange.count : 0;
+    draws[i].instanceCount = 1;
+    draws[i].firstIndex = mesh.indexRange.offset;
+    draws[i].vertexOffset = static_cast<int32_t>(mesh.vertexRange.offset);
+    draws[i].firstInstance = i;
+  }
+
+  stageCopy(chunkBoundsBuffer, {0, 0, boundsBytes});
+  stageCopy(chunkDrawsBuffer, {boundsBytes, 0, drawsBytes});
+}
+
+// Stays mapped until the frame that copies out of it retires, stageCopy reads from the newest one
+char* Renderer::stageUpload(VkDeviceSize size) {
+  StagingBuffer staging;
+  createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging.buffer, staging.memory);
+
+  void* data;
+  vkMapMemory(device, staging.memory, 0, size, 0, &data);
+  stagingBuffers.push_back(staging);
+  return static_cast<char*>(data);
+}
+
+void Renderer::stageCopy(VkBuffer target, VkBufferCopy region) {
+  stagedCopies.push_back({stagingBuffers.back().buffer, target, region});
+}
+
+// Frames still in flight may read the targets, so the copies wait for them and everything after waits for the copies
+void Renderer::recordUploads(VkCommandBuffer commandBuffer) {
+  if(stagedCopies.empty()) {
+    return;
   }
+
+  const VkPipelineStageFlags readers = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  vkCmdPipelineBarrier(commandBuffer, readers, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+  for(const StagedCopy& copy : stagedCopies) {
+    vkCmdCopyBuffer(commandBuffer, copy.source, copy.target, 1, &copy.region);
+  }
+
+  // Transfer too, released records are zeroed on top of the copied ones
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readers | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  for(const StagingBuffer& staging : stagingBuffers) {
+    releaseBuffer(staging.buffer, staging.memory);
+  }
+
+  stagedCopies.clear();
+  stagingBuffers.clear();
 }
 
 void Renderer::createDescriptorPool() {
-  std::array<VkDescriptorPoolSize, 2> poolSizes{};
+  // Second set of every kind is for the cull pass
+  std::array<VkDescriptorPoolSize, 3> poolSizes{};
   poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 2);
   poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
   poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[2].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 6);
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
   poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 2);
 
   if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not allocate descriptor pool\n");
@@ -607,7 +1356,12 @@ void Renderer::createDescriptorSets() {
     imageInfo.imageView = textureImageView;
     imageInfo.sampler = textureSampler;
 
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    VkDescriptorBufferInfo originInfo{};
+    originInfo.buffer = chunkOriginBuffer;
+    originInfo.offset = 0;
+    originInfo.range = VK_WHOLE_SIZE;
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrites[0].dstSet = descriptorSets[i];
     descriptorWrites[0].dstBinding = 0;
@@ -624,6 +1378,57 @@ void Renderer::createDescriptorSets() {
     descriptorWrites[1].descriptorCount = 1;
     descriptorWrites[1].pImageInfo = &imageInfo;
 
+    descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[2].dstSet = descriptorSets[i];
+    descriptorWrites[2].dstBinding = 2;
+    descriptorWrites[2].dstArrayElement = 0;
+    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[2].descriptorCount = 1;
+    descriptorWrites[2].pBufferInfo = &originInfo;
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+  }
+}
+
+void Renderer::createCullDescriptorSets() {
+  if(!gpuCulling) {
+    return;
+  }
+
+  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, cullDescriptorSetLayout);
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.pSetLayouts = layouts.data();
+
+  cullDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+
+  if (vkAllocateDescriptorSets(device, &allocInfo, cullDescriptorSets.data()) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not allocate cull descriptor sets\n");
+  }
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    std::array<VkDescriptorBufferInfo, 6> bufferInfos{};
+    bufferInfos[0] = {uniformBuffers[i], 0, sizeof(UniformBufferObject)};
+    bufferInfos[1] = {chunkBoundsBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[2] = {chunkDrawsBuffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[3] = {culledDrawBuffers[i], 0, VK_WHOLE_SIZE};
+    bufferInfos[4] = {drawCountBuffers[i], 0, VK_WHOLE_SIZE};
+    bufferInfos[5] = {reachableBuffers[i], 0, VK_WHOLE_SIZE};
+
+    std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
+    for (uint32_t j = 0; j < descriptorWrites.size(); ++j) {
+      descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      descriptorWrites[j].dstSet = cullDescriptorSets[i];
+      descriptorWrites[j].dstBinding = j;
+      descriptorWrites[j].dstArrayElement = 0;
+      descriptorWrites[j].descriptorType = j == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      descriptorWrites[j].descriptorCount = 1;
+      descriptorWrites[j].pBufferInfo = &bufferInfos[j];
+    }
+
     vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
   }
 }
@@ -640,12 +1445,21 @@ void Renderer::createCommandBuffers() {
   if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not allocate command buffers\n");
   }
+
+  // Models are recorded on the main thread every frame, there is one draw per model
+  modelCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+  if (vkAllocateCommandBuffers(device, &allocInfo, modelCommandBuffers.data()) != VK_SUCCESS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not allocate model command buffers\n");
+  }
 }
 
 void Renderer::createSyncObjects() {
   imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+  slotFrames.assign(MAX_FRAMES_IN_FLIGHT, 0);
 
   VkSemaphoreCreateInfo semaphoreInfo{};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -663,36 +1477,116 @@ void Renderer::createSyncObjects() {
   }
 }
 
-Renderer::Renderer(SDL_Window* window) {
-  // TODO: add model loading
-  // TODO: add mipmaps
-  // TODO: add compute shader
+Renderer::Renderer(SDL_Window* window, framePacing::LatencyMode latencyMode) {
   this->window = window;
+  this->latencyMode = latencyMode;
+  this->framesInFlight = framePacing::framesInFlight(latencyMode);
+
+  this->initialize();
+}
+
+Renderer::Renderer(uint32_t width, uint32_t height, const std::string& assetPackPath, bool gpuCulling) {
+  this->headless = true;
+  this->swapChainExtent = {width, height};
+  this->assetPackPath = assetPackPath;
+  this->allowGpuCulling = gpuCulling;
+
+  this->initialize();
+}
 
-  this->createInstance();
-  // TODO: Add validation layers
-  this->createSurface();
-  this->createLogicalDevice(this->pickPhysicalDevice());
-  this->createSwapChain();
-  this->createImageViews();
-  this->createRenderPass();
-  this->createDescriptorSetLayout();
-  this->createGraphicalPipeline();
-  this->createCommandPool();
-  this->createColorResource();
-  this->createDepthResources();
-  this->createFramebuffers();
-  this->createTextureImage();
-  this->createTextureImageView();
-  this->createTextureSampler();
-  this->createUniformBuffers();
-  this->createDescriptorPool();
-  this->createDescriptorSets();
-  this->createCommandBuffers();
-  this->createSyncObjects();
+void Renderer::initialize() {
+  PROFILE_ZONE("Renderer::initialize");
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  if(!assetPackPath.empty()) {
+    PROFILE_ZONE("map asset pack");
+    this->assets = assetPack::Archive(assetPackPath);
+  }
+
+  // Pipelines and texture decoding run on workers, everything that records or submits
+  // stays on this thread as callbacks and runs as soon as what it needs is there
+  taskGraph::TaskGraph startup;
+
+  taskGraph::Task deviceReady = startup.then("create device", {}, [this] {
+    this->createInstance();
+    // TODO: Add validation layers
+    this->createSurface();
+    this->createLogicalDevice(this->pickPhysicalDevice());
+    this->createPipelineCache();
+  });
+
+  taskGraph::Task passReady = startup.then("create render pass", {deviceReady}, [this] {
+    this->createSwapChain();
+    this->createRenderPass();
+    this->createDescriptorSetLayout();
+  });
+
+  taskGraph::Task pipelinesReady = startup.add("create pipelines", {passReady}, [this] {
+    this->createGraphicalPipeline();
+    this->createCullPipeline();
+    this->destroyShaderModules();
+  });
+
+  taskGraph::Task textureDecoded = startup.add("decode texture", {deviceReady}, [this] {
+    this->decodeTextureImage();
+  });
+
+  taskGraph::Task poolsReady = startup.then("create command pools", {deviceReady}, [this] {
+    this->createCommandPool();
+    this->createWorkerCommandPools();
+  });
+
+  startup.then("create render targets", {passReady, poolsReady}, [this] {
+    this->createRenderTargets();
+  });
+
+  taskGraph::Task textureReady = startup.then("upload texture", {textureDecoded, poolsReady}, [this] {
+    this->createTextureImage();
+    this->createTextureImageView();
+    this->createTextureSampler();
+  });
+
+  taskGraph::Task buffersReady = startup.then("create buffers", {poolsReady}, [this] {
+    this->createUniformBuffers();
+    this->createMeshArena();
+    this->createIndirectBuffers();
+    this->createChunkOriginBuffer();
+    this->loadModel(config::modelPath);
+    this->createCullingResources();
+  });
+
+  startup.then("create descriptor sets", {textureReady, buffersReady, pipelinesReady}, [this] {
+    this->createDescriptorPool();
+    this->createDescriptorSets();
+    this->createCullDescriptorSets();
+  });
+
+  startup.then("create frame resources", {poolsReady}, [this] {
+    this->createCommandBuffers();
+    this->createSyncObjects();
+  });
+
+  // The query pool has a slot per pipeline, so it waits until the pipelines are all in place
+  startup.then("create profiler", {pipelinesReady, poolsReady}, [this] {
+    this->createProfiler();
+  });
+
+  startup.waitAll();
+
+  // Headless frames are compared by hash, so they keep a fixed scale
+  if(!headless && profiler.hasTimestamps()) {
+    scaleController.setBudget(config::gpuFrameBudgetMs, maxMsaaSamples);
+  }
+
+  SDL_Log("Renderer init: %.2f ms (%s pipeline cache, %s assets)", static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency(), pipelineCacheWarm ? "warm" : "cold", assets.isOpen() ? "packed" : "loose");
 }
 
 Renderer::~Renderer() {
+  vkDeviceWaitIdle(device);
+  for(const StagingBuffer& staging : stagingBuffers) {
+    releaseBuffer(staging.buffer, staging.memory);
+  }
+  deletionQueue.flush(device);
   cleanupSwapChain();
 
   vkDestroySampler(device, textureSampler, nullptr);
@@ -705,27 +1599,72 @@ Renderer::~Renderer() {
     vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
   }
 
+  for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    vkDestroyBuffer(device, indirectBuffers[i], nullptr);
+    vkFreeMemory(device, indirectBuffersMemory[i], nullptr);
+  }
+
+  if(gpuCulling) {
+    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      vkDestroyBuffer(device, culledDrawBuffers[i], nullptr);
+      vkFreeMemory(device, culledDrawBuffersMemory[i], nullptr);
+      vkDestroyBuffer(device, drawCountBuffers[i], nullptr);
+      vkFreeMemory(device, drawCountBuffersMemory[i], nullptr);
+      vkDestroyBuffer(device, reachableBuffers[i], nullptr);
+      vkFreeMemory(device, reachableBuffersMemory[i], nullptr);
+    }
+
+    vkDestroyBuffer(device, chunkBoundsBuffer, nullptr);
+    vkFreeMemory(device, chunkBoundsBufferMemory, nullptr);
+    vkDestroyBuffer(device, chunkDrawsBuffer, nullptr);
+    vkFreeMemory(device, chunkDrawsBufferMemory, nullptr);
+
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
+  }
+
   vkDestroyDescriptorPool(device, descriptorPool, nullptr);
   vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
-  // TODO: use it
-  //vkDestroyBuffer(device, indexBuffer, nullptr);
-  //vkFreeMemory(device, indexBufferMemory, nullptr);
+  vkDestroyBuffer(device, chunkOriginBuffer, nullptr);
+  vkFreeMemory(device, chunkOriginBufferMemory, nullptr);
+
+  for(GpuModel& model : models) {
+    vkDestroyBuffer(device, model.buffer, nullptr);
+    vkFreeMemory(device, model.memory, nullptr);
+
+    for(size_t i = 0; i < model.instanceBuffers.size(); ++i) {
+      vkDestroyBuffer(device, model.instanceBuffers[i], nullptr);
+      vkFreeMemory(device, model.instanceBuffersMemory[i], nullptr);
+    }
+  }
 
-  //vkDestroyBuffer(device, vertexBuffer, nullptr);
-  //vkFreeMemory(device, vertexBufferMemory, nullptr);
+  vkDestroyBuffer(device, meshArena.indexBuffer, nullptr);
+  vkFreeMemory(device, meshArena.indexBufferMemory, nullptr);
 
-  //vkDestroyPipeline(device, graphicsPipeline, nullptr);
-  //vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyBuffer(device, meshArena.vertexBuffer, nullptr);
+  vkFreeMemory(device, meshArena.vertexBufferMemory, nullptr);
+
+  destroyGraphicalPipelines();
 
   vkDestroyRenderPass(device, renderPass, nullptr);
 
+  savePipelineCache();
+  vkDestroyPipelineCache(device, pipelineCache, nullptr);
+
   for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
     vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
     vkDestroyFence(device, inFlightFences[i], nullptr);
   }
 
+  for(VkCommandPool pool : workerCommandPools) {
+    vkDestroyCommandPool(device, pool, nullptr);
+  }
+
+  profiler.destroy();
+
   vkDestroyCommandPool(device, commandPool, nullptr);
   vkDestroyDevice(device, nullptr);
   vkDestroySurfaceKHR(instance, surface, nullptr);
@@ -733,40 +1672,77 @@ Renderer::~Renderer() {
 }
 
 void Renderer::drawFrame(Player* player, Terrain& terrain) {
-  vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+  PROFILE_ZONE("Renderer::drawFrame");
 
-  uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-  if(result == VK_ERROR_OUT_OF_DATE_KHR) {
-    recreateSwapChain();
-    return;
-  } else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not acquire next image\n");
+  {
+    PROFILE_ZONE("wait for frame fence");
+    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+  }
+
+  // One queue retires in submission order, so everything up to this slot's frame is done
+  completedFrame = std::max(completedFrame, slotFrames[currentFrame]);
+  deletionQueue.retire(device, completedFrame);
+
+  if(profiler.collect(currentFrame)) {
+    adaptRenderScale();
+  }
+
+  // Headless frames render into the offscreen image of their own slot
+  uint32_t imageIndex = currentFrame;
+  VkResult result = VK_SUCCESS;
+
+  if(!headless) {
+    PROFILE_ZONE("acquire image");
+    result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    if(result == VK_ERROR_OUT_OF_DATE_KHR) {
+      recreateSwapChain();
+      return;
+    } else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not acquire next image\n");
+    }
   }
 
   vkResetFences(device, 1, &inFlightFences[currentFrame]);
   vkResetCommandBuffer(commandBuffers[currentFrame], 0);
 
-  recordCommandBuffer(
-    commandBuffers[currentFrame],
-    imageIndex,
-    renderPass,
-    swapChainFramebuffers[imageIndex],
-    swapChainExtent,
-    pipelineLayout[player->renderType],
-    graphicsPipeline[player->renderType],
-    terrain
-  );
-
   updateUniformBuffer(currentFrame, player);
 
+  {
+    PROFILE_ZONE("cull chunks");
+    terrain.graph.potentiallyVisible(player->x, player->y, player->z, reachableChunks);
+
+    if(gpuCulling) {
+      uint32_t* reachable = static_cast<uint32_t*>(reachableBuffersMapped[currentFrame]);
+      for(uint32_t i = 0; i < chunkCount; ++i) {
+        reachable[i] = reachableChunks[i];
+      }
+    } else {
+      drawCount = updateDrawCommands(currentFrame, terrain, player);
+    }
+  }
+
+  recordChunkGroups(player->renderType);
+  updateModelInstances(currentFrame);
+
+  {
+    PROFILE_ZONE("record primary");
+    recordCommandBuffer(
+      commandBuffers[currentFrame],
+      imageIndex,
+      renderPass,
+      sceneFramebuffer,
+      renderExtent
+    );
+  }
+
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
   VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  // The swapchain image is only touched by the upscale blit
+  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_TRANSFER_BIT};
 
-  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.waitSemaphoreCount = headless ? 0 : 1;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
 
@@ -774,11 +1750,26 @@ void Renderer::drawFrame(Player* player, Terrain& terrain) {
   submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
   VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.signalSemaphoreCount = headless ? 0 : 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "vkQueueSubmit failed\n");
+  {
+    PROFILE_ZONE("submit");
+    if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "vkQueueSubmit failed\n");
+    }
+  }
+
+  slotFrames[currentFrame] = ++submittedFrames;
+
+  profiler.submitted(currentFrame);
+  lastImage = imageIndex;
+
+  // There is nothing to present, the submit is as far as a headless frame goes
+  if(headless) {
+    presentedAt = SDL_GetTicksNS();
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    return;
   }
 
   VkPresentInfoKHR presentInfo{};
@@ -791,7 +1782,12 @@ void Renderer::drawFrame(Player* player, Terrain& terrain) {
   presentInfo.pSwapchains = swapChains;
   presentInfo.pImageIndices = &imageIndex;
 
-  result = vkQueuePresentKHR(presentQueue, &presentInfo);
+  {
+    PROFILE_ZONE("present");
+    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    presentedAt = SDL_GetTicksNS();
+  }
+
   if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
     framebufferResized = false;
     recreateSwapChain();
@@ -799,7 +1795,25 @@ void Renderer::drawFrame(Player* player, Terrain& terrain) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "vkQueuePresentKHR failed\n");
   }
 
-  currentFrame = !currentFrame;
+  currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+// Every frame slot is idle after the wait, so the rotation can restart at zero with a new depth
+void Renderer::setLatencyMode(framePacing::LatencyMode mode) {
+  vkDeviceWaitIdle(device);
+
+  latencyMode = mode;
+  framesInFlight = framePacing::framesInFlight(mode);
+  currentFrame = 0;
+  completedFrame = submittedFrames;
+  deletionQueue.retire(device, completedFrame);
+
+  recreateSwapChain();
+  SDL_Log("Latency mode: %s, %u frames in flight", framePacing::name(mode), framesInFlight);
+}
+
+framePacing::LatencyMode Renderer::getLatencyMode() const {
+  return latencyMode;
 }
 
 void Renderer::windowResized() {
@@ -807,20 +1821,15 @@ void Renderer::windowResized() {
 }
 
 void Renderer::cleanupSwapChain() {
-  vkDestroyImageView(device, colorImageView, nullptr);
-  vkDestroyImage(device, colorImage, nullptr);
-  vkFreeMemory(device, colorImageMemory, nullptr);
-
-  vkDestroyImageView(device, depthImageView, nullptr);
-  vkDestroyImage(device, depthImage, nullptr);
-  vkFreeMemory(device, depthImageMemory, nullptr);
+  cleanupRenderTargets();
 
-  for(auto imageView : swapChainImageViews) {
-    vkDestroyImageView(device, imageView, nullptr);
-  }
+  if(headless) {
+    for(size_t i = 0; i < swapChainImages.size(); ++i) {
+      vkDestroyImage(device, swapChainImages[i], nullptr);
+      vkFreeMemory(device, offscreenImagesMemory[i], nullptr);
+    }
 
-  for (auto framebuffer : swapChainFramebuffers) {
-    vkDestroyFramebuffer(device, framebuffer, nullptr);
+    return;
   }
 
   vkDestroySwapchainKHR(device, swapChain, nullptr);
@@ -832,10 +1841,79 @@ void Renderer::recreateSwapChain() {
   cleanupSwapChain();
 
   createSwapChain();
-  createImageViews();
-  createColorResource();
-  createDepthResources();
-  createFramebuffers();
+  createRenderTargets();
+
+  invalidateChunkGroups();
+}
+
+void Renderer::updateRenderExtent() {
+  renderExtent.width = std::max(static_cast<uint32_t>(swapChainExtent.width * scaleController.scale), 1u);
+  renderExtent.height = std::max(static_cast<uint32_t>(swapChainExtent.height * scaleController.scale), 1u);
+
+  // Recorded groups carry the old viewport
+  invalidateChunkGroups();
+}
+
+// The sample count is baked into the render pass, the pipelines and the attachments
+void Renderer::applySampleCount() {
+  vkDeviceWaitIdle(device);
+
+  cleanupRenderTargets();
+  destroyGraphicalPipelines();
+  vkDestroyRenderPass(device, renderPass, nullptr);
+
+  msaaSamples = static_cast<VkSampleCountFlagBits>(scaleController.samples);
+
+  createRenderPass();
+  createGraphicalPipeline();
+  destroyShaderModules();
+  createRenderTargets();
+}
+
+void Renderer::adaptRenderScale() {
+  renderScale::Change change = scaleController.update(profiler.frame.latest());
+
+  if(change == renderScale::Change::None) {
+    return;
+  }
+
+  if(change == renderScale::Change::Samples) {
+    applySampleCount();
+  } else {
+    updateRenderExtent();
+  }
+
+  SDL_Log("Render scale %.2f, %ux MSAA (GPU %.2f ms for a %.2f ms budget)", scaleController.scale, scaleController.samples, profiler.frame.latest(), scaleController.budgetMs);
+}
+
+void Renderer::setFrameBudget(double ms) {
+  scaleController.setBudget(ms, maxMsaaSamples);
+}
+
+void Renderer::setRenderScale(float scale) {
+  scaleController.scale = std::clamp(scale, config::minRenderScale, 1.0f);
+  scaleController.settle();
+  updateRenderExtent();
+}
+
+// Falls to the nearest supported count below the request
+void Renderer::setMsaaSamples(uint32_t samples) {
+  uint32_t count = std::min(std::bit_floor(std::max(samples, 1u)), static_cast<uint32_t>(maxMsaaSamples));
+  if(!(scaleController.supportedSamples & count)) {
+    count = renderScale::fewerSamples(count, scaleController.supportedSamples);
+  }
+
+  scaleController.samples = count;
+  scaleController.settle();
+  applySampleCount();
+}
+
+float Renderer::getRenderScale() const {
+  return scaleController.scale;
+}
+
+uint32_t Renderer::getMsaaSamples() const {
+  return static_cast<uint32_t>(msaaSamples);
 }
 
 SwapChainSupportDetails Renderer::querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
@@ -873,9 +1951,9 @@ VkSurfaceFormatKHR Renderer::chooseSwapSurfaceFormat(const std::vector<VkSurface
 }
 
 VkPresentModeKHR Renderer::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-  for (const auto& availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      return availablePresentMode;
+  for (VkPresentModeKHR preferred : framePacing::presentModes(latencyMode)) {
+    if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferred) != availablePresentModes.end()) {
+      return preferred;
     }
   }
 
@@ -905,7 +1983,8 @@ std::vector<char> Renderer::readFile(const std::string& filename) {
   std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
   if (!file.is_open()) {
-    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read file\n");
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not read file %s\n", filename.c_str());
+    return {};
   }
 
   size_t fileSize = static_cast<size_t>(file.tellg());
@@ -918,7 +1997,7 @@ std::vector<char> Renderer::readFile(const std::string& filename) {
   return buffer;
 }
 
-VkShaderModule Renderer::createShaderModule(const std::vector<char>& code, VkDevice device) {
+VkShaderModule Renderer::createShaderModule(std::span<const char> code, VkDevice device) {
   VkShaderModuleCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
   createInfo.codeSize = code.size();
@@ -932,20 +2011,65 @@ VkShaderModule Renderer::createShaderModule(const std::vector<char>& code, VkDev
   return shaderModule;
 }
 
+// Packed assets are viewed in place, anything else is read from under the asset root into storage
+std::span<const char> Renderer::loadAsset(const std::string& name, std::vector<char>& storage) {
+  if(const assetPack::Entry* entry = assets.find(name)) {
+    std::span<const unsigned char> bytes = assets.bytes(*entry);
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+  }
+
+  storage = readFile(config::assetRoot + name);
+  return storage;
+}
+
+// Every name is read and turned into a module once, however many pipelines use it
+VkShaderModule Renderer::loadShaderModule(const std::string& name) {
+  auto it = shaderModules.find(name);
+  if(it != shaderModules.end()) {
+    return it->second;
+  }
+
+  std::vector<char> storage;
+  VkShaderModule shaderModule = createShaderModule(loadAsset(name, storage), device);
+  shaderModules.emplace(name, shaderModule);
+
+  return shaderModule;
+}
+
+void Renderer::destroyShaderModules() {
+  for(const auto& [filename, shaderModule] : shaderModules) {
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+  }
+
+  shaderModules.clear();
+}
+
 void Renderer::recordCommandBuffer(
   VkCommandBuffer commandBuffer,
   uint32_t imageIndex,
   VkRenderPass renderPass,
   VkFramebuffer framebuffer,
-  VkExtent2D extent,
-  std::vector<VkPipelineLayout> pipelineLayout,
-  std::vector<VkPipeline> pipeline,
-  Terrain& terrain
+  VkExtent2D extent
 ) {
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
+  uint32_t firstQuery = currentFrame * profiler.queriesPerFrame;
+  profiler.reset(commandBuffer, currentFrame);
+  profiler.timestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, firstQuery + GpuProfiler::FrameBegin);
+
+  recordUploads(commandBuffer);
+
+  if(gpuCulling) {
+    recordCulling(commandBuffer);
+  }
+
+  profiler.timestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, firstQuery + GpuProfiler::PassBegin);
+  profiler.beginStatistics(commandBuffer, currentFrame);
+
+  bool drawModels = recordModels(currentFrame);
+
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = renderPass;
@@ -960,38 +2084,252 @@ void Renderer::recordCommandBuffer(
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  // Every group lays down depth before any of them shades
+  std::vector<VkCommandBuffer> secondaryBuffers;
+  for(const ChunkGroup& group : chunkGroups) {
+    if(group.chunkCount > 0 && usesDepthPrepass(group.recordedRenderType[currentFrame])) {
+      secondaryBuffers.push_back(group.depthCommandBuffers[currentFrame]);
+    }
+  }
+
+  for(const ChunkGroup& group : chunkGroups) {
+    if(group.chunkCount > 0) {
+      secondaryBuffers.push_back(group.commandBuffers[currentFrame]);
+    }
+  }
+
+  if(drawModels) {
+    secondaryBuffers.push_back(modelCommandBuffers[currentFrame]);
+  }
+
+  if(!secondaryBuffers.empty()) {
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+  }
+
+  vkCmdEndRenderPass(commandBuffer);
+
+  profiler.endStatistics(commandBuffer, currentFrame);
+  profiler.timestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, firstQuery + GpuProfiler::PassEnd);
+
+  recordUpscale(commandBuffer, imageIndex);
+
+  profiler.timestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, firstQuery + GpuProfiler::FrameEnd);
+
+  vkEndCommandBuffer(commandBuffer);
+}
+
+// Stretches the rendered part of the scene image over the whole target
+void Renderer::recordUpscale(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = swapChainImages[imageIndex];
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  VkImageBlit blit{};
+  blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+  blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  blit.srcSubresource.layerCount = 1;
+  blit.dstOffsets[1] = {static_cast<int32_t>(swapChainExtent.width), static_cast<int32_t>(swapChainExtent.height), 1};
+  blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  blit.dstSubresource.layerCount = 1;
+  vkCmdBlitImage(commandBuffer, sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, upscaleFilter);
+
+  // Headless targets stay readable by readFrame
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = headless ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, headless ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// Compute culling compacts draws into one buffer, so then a single group covers every chunk
+void Renderer::updateChunkGroups(uint32_t slotCount) {
+  uint32_t groupSize = gpuCulling ? std::max(slotCount, 1u) : config::chunksPerGroup;
+  uint32_t groupCount = (slotCount + groupSize - 1) / groupSize;
+
+  while(chunkGroups.size() < groupCount) {
+    ChunkGroup group;
+    group.commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    group.depthCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    group.recordedRenderType.assign(MAX_FRAMES_IN_FLIGHT, UINT32_MAX);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = workerCommandPools[chunkGroups.size() % workerCommandPools.size()];
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(group.commandBuffers.size());
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, group.commandBuffers.data()) != VK_SUCCESS || vkAllocateCommandBuffers(device, &allocInfo, group.depthCommandBuffers.data()) != VK_SUCCESS) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not allocate secondary command buffers\n");
+    }
+
+    chunkGroups.push_back(group);
+  }
+
+  for(uint32_t g = 0; g < chunkGroups.size(); ++g) {
+    ChunkGroup& group = chunkGroups[g];
+    uint32_t firstChunk = g * groupSize;
+    uint32_t count = g < groupCount ? std::min(groupSize, slotCount - firstChunk) : 0;
+
+    if(group.firstChunk != firstChunk || group.chunkCount != count) {
+      group.firstChunk = firstChunk;
+      group.chunkCount = count;
+      std::fill(group.recordedRenderType.begin(), group.recordedRenderType.end(), UINT32_MAX);
+    }
+  }
+}
+
+void Renderer::invalidateChunkGroups() {
+  for(ChunkGroup& group : chunkGroups) {
+    std::fill(group.recordedRenderType.begin(), group.recordedRenderType.end(), UINT32_MAX);
+  }
+}
+
+// Only stale groups are recorded again, each worker owns the groups allocated from its pool
+void Renderer::recordChunkGroups(uint32_t renderType) {
+  PROFILE_ZONE("Renderer::recordChunkGroups");
+
+  // One task per command pool, whichever thread runs it is the only one using that pool
+  for(size_t w = 0; w < workerCommandPools.size(); ++w) {
+    bool stale = false;
+    for(size_t g = w; g < chunkGroups.size(); g += workerCommandPools.size()) {
+      stale |= chunkGroups[g].chunkCount > 0 && chunkGroups[g].recordedRenderType[currentFrame] != renderType;
+    }
+
+    if(!stale) {
+      continue;
+    }
+
+    recordWorkers->add("record chunk groups", {}, [this, w, renderType]() {
+      for(size_t g = w; g < chunkGroups.size(); g += workerCommandPools.size()) {
+        ChunkGroup& group = chunkGroups[g];
+
+        if(group.chunkCount > 0 && group.recordedRenderType[currentFrame] != renderType) {
+          recordChunkGroup(group, static_cast<uint32_t>(g), currentFrame, renderType);
+          group.recordedRenderType[currentFrame] = renderType;
+        }
+      }
+    });
+  }
+
+  recordWorkers->waitAll();
+  recordWorkers->clear();
+}
+
+void Renderer::recordChunkGroup(const ChunkGroup& group, uint32_t groupIndex, uint32_t frame, uint32_t renderType) {
+  VkCommandBuffer commandBuffer = group.commandBuffers[frame];
+  beginChunkGroup(commandBuffer);
+
+  const std::vector<VkPipelineLayout>& layouts = pipelineLayout[renderType];
+  const std::vector<VkPipeline>& pipelines = graphicsPipeline[renderType];
+
+  for(size_t i = 0; i < pipelines.size(); ++i) {
+    uint32_t query = profiler.pipelineQuery(frame, groupIndex, static_cast<uint32_t>(i));
+    profiler.timestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[i]);
+    recordChunkDraws(commandBuffer, group, frame, layouts[i]);
+
+    profiler.timestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query + 1);
+  }
+
+  vkEndCommandBuffer(commandBuffer);
+
+  if(usesDepthPrepass(renderType)) {
+    VkCommandBuffer depthCommandBuffer = group.depthCommandBuffers[frame];
+    beginChunkGroup(depthCommandBuffer);
+
+    vkCmdBindPipeline(depthCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline);
+    recordChunkDraws(depthCommandBuffer, group, frame, depthPipelineLayout);
+
+    vkEndCommandBuffer(depthCommandBuffer);
+  }
+}
+
+void Renderer::beginChunkGroup(VkCommandBuffer commandBuffer) {
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+  inheritanceInfo.pipelineStatistics = profiler.statisticFlags;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
+  // Dynamic state is not inherited from the primary
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = (float) extent.width;
-  viewport.height = (float) extent.height;
+  viewport.width = (float) renderExtent.width;
+  viewport.height = (float) renderExtent.height;
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
   vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
   VkRect2D scissor{};
   scissor.offset = {0, 0};
-  scissor.extent = extent;
+  scissor.extent = renderExtent;
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
 
-  for(size_t i = 0; i < pipeline.size(); ++i) {
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline[i]);
-    VkBuffer vertexBuffers[] = {terrain.vertexBuffer};
-    VkDeviceSize offsets[] = {0};
+void Renderer::recordChunkDraws(VkCommandBuffer commandBuffer, const ChunkGroup& group, uint32_t frame, VkPipelineLayout layout) {
+  VkBuffer vertexBuffers[] = {meshArena.vertexBuffer};
+  VkDeviceSize offsets[] = {0};
+  VkDeviceSize firstCommand = group.firstChunk * sizeof(VkDrawIndexedIndirectCommand);
 
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, terrain.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+  vkCmdBindIndexBuffer(commandBuffer, meshArena.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout[i], 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSets[frame], 0, nullptr);
 
-    // TODO: Add drawing per batch/chunk
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(terrain.indices.size()), 1, 0, 0, 0);
+  if(gpuCulling) {
+    vkCmdDrawIndexedIndirectCount(commandBuffer, culledDrawBuffers[frame], 0, drawCountBuffers[frame], 0, group.chunkCount, sizeof(VkDrawIndexedIndirectCommand));
+  } else if(deviceFeatures.multiDrawIndirect) {
+    vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffers[frame], firstCommand, group.chunkCount, sizeof(VkDrawIndexedIndirectCommand));
+  } else {
+    for(uint32_t j = 0; j < group.chunkCount; ++j) {
+      vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffers[frame], firstCommand + j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
   }
+}
 
-  vkCmdEndRenderPass(commandBuffer);
-  vkEndCommandBuffer(commandBuffer);
+// Type 2 draws only lines, which the depth of the filled faces would hide
+bool Renderer::usesDepthPrepass(uint32_t renderType) const {
+  return depthPrepass && renderType != 2;
+}
+
+void Renderer::setDepthPrepass(bool enabled) {
+  depthPrepass = enabled;
+  invalidateChunkGroups();
+}
+
+void Renderer::setChunkSorting(bool enabled) {
+  sortChunks = enabled;
+}
+
+bool Renderer::hasPipelineStatistics() const {
+  return profiler.hasStatistics();
+}
+
+double Renderer::lastFragmentInvocations() const {
+  return profiler.fragmentInvocations.latest();
 }
 
 void Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
@@ -1020,7 +2358,7 @@ void Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemor
   vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
 
-void Renderer::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSample, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void Renderer::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers, VkSampleCountFlagBits numSample, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -1028,7 +2366,7 @@ void Renderer::createImage(uint32_t width, uint32_t height, uint32_t mipLevels,
   imageInfo.extent.height = height;
   imageInfo.extent.depth = 1;
   imageInfo.mipLevels = mipLevels;
-  imageInfo.arrayLayers = 1;
+  imageInfo.arrayLayers = layers;
   imageInfo.format = format;
   imageInfo.tiling = tiling;
   imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1065,23 +2403,218 @@ void Renderer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize s
   endSingleTimeCommands(commandBuffer);
 }
 
-void Renderer::updateUniformBuffer(bool currentFrame, Player* player) {
-  calc::Mat4 rotation = calc::Mat4::MRotationX(calc::degrees(player->mouseY)) *  calc::Mat4::MRotationY(calc::degrees(player->mouseX));
-
-  calc::Mat4 translation = calc::Mat4::MIdentity();
-  translation(0, 3) = -player->x;
-  translation(1, 3) = -player->y;
-  translation(2, 3) = -player->z;
-
+void Renderer::updateUniformBuffer(uint32_t currentFrame, Player* player) {
   UniformBufferObject ubo{};
-  ubo.model = calc::Mat4::MIdentity();
-  ubo.trans = translation;
-  ubo.rot = rotation;
-  ubo.proj = calc::Mat4::perspective(player->getFOV(), static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height), 0.1f, 100.0f);
+  calc::Mat4 proj = player->projection(static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height));
+  ubo.viewProj = proj * player->rotation();
+
+  // Culling still works on world space boxes, a few centimetres of error there is harmless
+  frustumPlanes = (ubo.viewProj * player->translation()).frustumPlanes();
+  ubo.frustum = frustumPlanes;
+
+  std::array<double, 3> position = {player->x, player->y, player->z};
+  for(int i = 0; i < 3; ++i) {
+    double chunk = std::floor(position[i] / 16.0);
+    ubo.cameraChunk[i] = static_cast<int32_t>(chunk);
+    ubo.cameraOffset[i] = static_cast<float>(position[i] - chunk * 16.0);
+  }
 
   memcpy(uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
 }
 
+// Recorded groups cover fixed slots and unused ones draw zero instances, sorted frames pack the nearest chunks into the first slots
+uint32_t Renderer::updateDrawCommands(uint32_t currentFrame, const Terrain& terrain, const Player* player) {
+  VkDrawIndexedIndirectCommand* commands = static_cast<VkDrawIndexedIndirectCommand*>(indirectBuffersMapped[currentFrame]);
+  uint32_t slots = std::min(static_cast<uint32_t>(terrain.meshes.size()), config::maxChunkDraws);
+  uint32_t count = 0;
+
+  memset(commands, 0, sizeof(VkDrawIndexedIndirectCommand) * slots);
+
+  culling::drawList(terrain, frustumPlanes, reachableChunks, static_cast<float>(player->x), static_cast<float>(player->y), static_cast<float>(player->z), sortChunks ? &chunkSorter : nullptr, visibleChunks);
+
+  for(uint32_t chunk : visibleChunks) {
+    const ChunkMesh& mesh = terrain.meshes[chunk];
+    uint32_t slot = sortChunks ? count : chunk;
+
+    commands[slot].indexCount = mesh.indexRange.count;
+    commands[slot].instanceCount = 1;
+    commands[slot].firstIndex = mesh.indexRange.offset;
+    commands[slot].vertexOffset = static_cast<int32_t>(mesh.vertexRange.offset);
+    commands[slot].firstInstance = chunk;
+    ++count;
+  }
+
+  return count;
+}
+
+void Renderer::recordCulling(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+  // Only the index count of a released chunk changes, earlier frames finish culling before it is written
+  if(!releasedChunkRecords.empty()) {
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    const uint32_t noIndices = 0;
+    for(uint32_t chunk : releasedChunkRecords) {
+      VkDeviceSize offset = sizeof(VkDrawIndexedIndirectCommand) * chunk + offsetof(VkDrawIndexedIndirectCommand, indexCount);
+      vkCmdUpdateBuffer(commandBuffer, chunkDrawsBuffer, offset, sizeof(noIndices), &noIndices);
+    }
+    releasedChunkRecords.clear();
+  }
+
+  vkCmdFillBuffer(commandBuffer, drawCountBuffers[currentFrame], 0, sizeof(uint32_t), 0);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSets[currentFrame], 0, nullptr);
+  vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &chunkCount);
+  vkCmdDispatch(commandBuffer, (chunkCount + 63) / 64, 1, 1);
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+// Every chunk group can time each pipeline of the widest render type
+void Renderer::createProfiler() {
+  uint32_t maxPipelines = 0;
+  for(const std::vector<VkPipeline>& pipelines : graphicsPipeline) {
+    maxPipelines = std::max(maxPipelines, static_cast<uint32_t>(pipelines.size()));
+  }
+
+  uint32_t maxGroups = gpuCulling ? 1 : (config::maxChunkDraws + config::chunksPerGroup - 1) / config::chunksPerGroup;
+  profiler.create(device, deviceProperties, deviceFeatures, MAX_FRAMES_IN_FLIGHT, maxGroups, maxPipelines);
+}
+
+double Renderer::lastGpuTimeMs() const {
+  return profiler.frame.latest();
+}
+
+uint64_t Renderer::lastPresentNs() const {
+  return presentedAt;
+}
+
+std::string Renderer::gpuReport() const {
+  return profiler.report();
+}
+
+// Waits for the GPU and copies the newest headless frame out as tightly packed RGBA
+bool Renderer::readFrame(std::vector<uint8_t>& pixels, uint32_t& width, uint32_t& height) {
+  if(!headless) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Frames can only be read back from a headless renderer\n");
+    return false;
+  }
+
+  vkDeviceWaitIdle(device);
+
+  width = swapChainExtent.width;
+  height = swapChainExtent.height;
+  VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
+
+  VkBuffer readbackBuffer;
+  VkDeviceMemory readbackBufferMemory;
+  createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferMemory);
+
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[lastImage], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+  endSingleTimeCommands(commandBuffer);
+
+  pixels.resize(static_cast<size_t>(imageSize));
+
+  void* data;
+  vkMapMemory(device, readbackBufferMemory, 0, imageSize, 0, &data);
+  memcpy(pixels.data(), data, pixels.size());
+  vkUnmapMemory(device, readbackBufferMemory);
+
+  vkDestroyBuffer(device, readbackBuffer, nullptr);
+  vkFreeMemory(device, readbackBufferMemory, nullptr);
+  return true;
+}
+
+bool Renderer::hasGpuCulling() const {
+  return gpuCulling;
+}
+
+// Reads back what the compute pass kept in the last submitted frame and compares it with the CPU culler
+bool Renderer::verifyGpuCulling(const Terrain& terrain) {
+  if(!gpuCulling) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "GPU culling is not supported on this device\n");
+    return false;
+  }
+
+  vkDeviceWaitIdle(device);
+
+  uint32_t frame = (currentFrame + framesInFlight - 1) % framesInFlight;
+  VkDeviceSize commandBytes = sizeof(VkDrawIndexedIndirectCommand) * chunkCount;
+
+  VkBuffer readbackBuffer;
+  VkDeviceMemory readbackBufferMemory;
+  createBuffer(sizeof(uint32_t) + commandBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferMemory);
+
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  VkBufferCopy countCopy{0, 0, sizeof(uint32_t)};
+  vkCmdCopyBuffer(commandBuffer, drawCountBuffers[frame], readbackBuffer, 1, &countCopy);
+
+  if(commandBytes > 0) {
+    VkBufferCopy commandCopy{0, sizeof(uint32_t), commandBytes};
+    vkCmdCopyBuffer(commandBuffer, culledDrawBuffers[frame], readbackBuffer, 1, &commandCopy);
+  }
+
+  endSingleTimeCommands(commandBuffer);
+
+  char* data;
+  vkMapMemory(device, readbackBufferMemory, 0, sizeof(uint32_t) + commandBytes, 0, reinterpret_cast<void**>(&data));
+
+  uint32_t count;
+  memcpy(&count, data, sizeof(uint32_t));
+
+  // Draws land in whatever order the atomics hand out slots, so both sides get sorted by first index
+  std::vector<uint32_t> gpuDraws, cpuDraws;
+  for(uint32_t i = 0; i < std::min(count, chunkCount); ++i) {
+    VkDrawIndexedIndirectCommand command;
+    memcpy(&command, data + sizeof(uint32_t) + i * sizeof(VkDrawIndexedIndirectCommand), sizeof(command));
+    gpuDraws.push_back(command.firstIndex);
+  }
+
+  vkUnmapMemory(device, readbackBufferMemory);
+  vkDestroyBuffer(device, readbackBuffer, nullptr);
+  vkFreeMemory(device, readbackBufferMemory, nullptr);
+
+  culling::cullChunks(terrain.bounds, frustumPlanes, visibleChunks);
+  for(uint32_t chunk : visibleChunks) {
+    if(chunk < chunkCount && terrain.meshes[chunk].uploaded && reachableChunks[chunk]) {
+      cpuDraws.push_back(terrain.meshes[chunk].indexRange.offset);
+    }
+  }
+
+  std::sort(gpuDraws.begin(), gpuDraws.end());
+  std::sort(cpuDraws.begin(), cpuDraws.end());
+
+  if(gpuDraws != cpuDraws) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "GPU culling kept %u chunks, CPU culling kept %zu\n", count, cpuDraws.size());
+    return false;
+  }
+
+  return true;
+}
+
 VkCommandBuffer Renderer::beginSingleTimeCommands() {
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1115,7 +2648,7 @@ void Renderer::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-void Renderer::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
+void Renderer::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layers) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkImageMemoryBarrier barrier{};
@@ -1126,9 +2659,9 @@ void Renderer::transitionImageLayout(VkImage image, VkFormat format, VkImageLayo
   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barrier.image = image;
   barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.levelCount = mipLevels;
   barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
+  barrier.subresourceRange.layerCount = layers;
   barrier.srcAccessMask = 0;
   barrier.dstAccessMask = 0;
 
@@ -1172,38 +2705,83 @@ void Renderer::transitionImageLayout(VkImage image, VkFormat format, VkImageLayo
   endSingleTimeCommands(commandBuffer);
 }
 
-void Renderer::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
+void Renderer::copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
-  VkBufferImageCopy region{};
-  region.bufferOffset = 0;
-  region.bufferRowLength = 0;
-  region.bufferImageHeight = 0;
+  vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
 
-  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount = 1;
+  endSingleTimeCommands(commandBuffer);
+}
 
-  region.imageOffset = {0, 0, 0};
-  region.imageExtent = {width, height, 1};
+// Each level is blitted from the one above it, all layers at once
+void Renderer::generateMipmaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mipLevels, uint32_t layers) {
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.image = image;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = layers;
+  barrier.subresourceRange.levelCount = 1;
+
+  int32_t mipWidth = width, mipHeight = height;
+
+  for(uint32_t level = 1; level < mipLevels; ++level) {
+    barrier.subresourceRange.baseMipLevel = level - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkImageBlit blit{};
+    blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel = level - 1;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = layers;
+    blit.dstOffsets[1] = {std::max(mipWidth / 2, 1), std::max(mipHeight / 2, 1), 1};
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.mipLevel = level;
+    blit.dstSubresource.baseArrayLayer = 0;
+    blit.dstSubresource.layerCount = layers;
+    vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-  vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    mipWidth = std::max(mipWidth / 2, 1);
+    mipHeight = std::max(mipHeight / 2, 1);
+  }
+
+  // The last level was only ever written
+  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
   endSingleTimeCommands(commandBuffer);
 }
 
-VkImageView Renderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView Renderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType, uint32_t mipLevels, uint32_t layers) {
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.image = image;
-  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.viewType = viewType;
   viewInfo.format = format;
   viewInfo.subresourceRange.aspectMask = aspectFlags;
   viewInfo.subresourceRange.baseMipLevel = 0;
-  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.levelCount = mipLevels;
   viewInfo.subresourceRange.baseArrayLayer = 0;
-  viewInfo.subresourceRange.layerCount = 1;
+  viewInfo.subresourceRange.layerCount = layers;
 
   VkImageView imageView;
   if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
@@ -1243,6 +2821,8 @@ bool Renderer::hasStencilComponent(VkFormat format) {
 VkSampleCountFlagBits Renderer::getMaxUsableSampleCount() {
   VkSampleCountFlags counts = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
 
+  counts &= (config::maxMsaaSamples << 1) - 1;
+
   if(counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
   if(counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
   if(counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
@@ -1253,13 +2833,10 @@ VkSampleCountFlagBits Renderer::getMaxUsableSampleCount() {
   return VK_SAMPLE_COUNT_1_BIT;
 }
 
-std::pair<VkPipelineLayout, VkPipeline> Renderer::createPipeline(const std::string& vertShader, const std::string& fragShader, const VkPolygonMode& polygonMode) {
-  std::vector<char> vertShaderCode = Renderer::readFile(vertShader);
-  std::vector<char> fragShaderCode = Renderer::readFile(fragShader);
-
-  VkShaderModule vertShaderModule = Renderer::createShaderModule(vertShaderCode, device);
-  VkShaderModule fragShaderModule = Renderer::createShaderModule(fragShaderCode, device);
-
+// Without a fragment module the pipeline only writes depth, for the pre-pass
+std::pair<VkPipelineLayout, VkPipeline> Renderer::createPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const VkPolygonMode& polygonMode, VertexInput input) {
+  PROFILE_THREAD("pipeline builder");
+  PROFILE_ZONE("Renderer::createPipeline");
   VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
   vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -1281,13 +2858,22 @@ std::pair<VkPipelineLayout, VkPipeline> Renderer::createPipeline(const std::stri
 
   auto bindingDescription = Vertex::getBindingDescription();
   auto attributeDescriptions = Vertex::getAttributeDescriptions();
+  auto modelBindingDescriptions = ModelInstance::getBindingDescriptions();
+  auto modelAttributeDescriptions = ModelInstance::getAttributeDescriptions();
 
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.vertexBindingDescriptionCount = 1;
-  vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-  vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-  vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+  if(input == VertexInput::Model) {
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(modelBindingDescriptions.size());
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(modelAttributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = modelBindingDescriptions.data();
+    vertexInputInfo.pVertexAttributeDescriptions = modelAttributeDescriptions.data();
+  } else {
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+  }
 
   VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
   inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -1325,12 +2911,12 @@ std::pair<VkPipelineLayout, VkPipeline> Renderer::createPipeline(const std::stri
 
   VkPipelineMultisampleStateCreateInfo multisampling{};
   multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.sampleShadingEnable = VK_TRUE;
+  multisampling.sampleShadingEnable = deviceFeatures.sampleRateShading && msaaSamples != VK_SAMPLE_COUNT_1_BIT;
   multisampling.minSampleShading = 0.2f;
   multisampling.rasterizationSamples = msaaSamples;
 
   VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-  colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  colorBlendAttachment.colorWriteMask = fragShaderModule == VK_NULL_HANDLE ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
   colorBlendAttachment.blendEnable = VK_FALSE;
   colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
   colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
@@ -1354,7 +2940,8 @@ std::pair<VkPipelineLayout, VkPipeline> Renderer::createPipeline(const std::stri
   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depthStencil.depthTestEnable = VK_TRUE;
   depthStencil.depthWriteEnable = VK_TRUE;
-  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  // Equal depth has to pass once the pre-pass has written it
+  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
   depthStencil.depthBoundsTestEnable = VK_FALSE; // TODO: use these
   depthStencil.minDepthBounds = 0.0f;            //
   depthStencil.maxDepthBounds = 1.0f;            //
@@ -1370,7 +2957,7 @@ std::pair<VkPipelineLayout, VkPipeline> Renderer::createPipeline(const std::stri
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = fragShaderModule == VK_NULL_HANDLE ? 1 : 2;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &inputAssembly;
@@ -1386,12 +2973,9 @@ std::pair<VkPipelineLayout, VkPipeline> Renderer::createPipeline(const std::stri
 
   VkPipeline pipeline;
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+  if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Could not create pipeline\n");
   }
 
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
-  vkDestroyShaderModule(device, fragShaderModule, nullptr);
-
   return {pipelineLayout, pipeline};
 }
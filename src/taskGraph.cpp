@@ -0,0 +1,231 @@
+#include "../include/taskGraph.hpp"
+
+#include "../include/profiler.hpp"
+#include <algorithm>
+
+namespace taskGraph {
+TaskGraph::TaskGraph(uint32_t threads) {
+  for(uint32_t i = 0; i < threads; ++i) {
+    workers.emplace_back(&TaskGraph::workerLoop, this);
+  }
+}
+
+TaskGraph::~TaskGraph() {
+  // Nothing can be rethrown from here, whoever cared about a failure waited for it already
+  runCallbacksUntil([this] { return unfinished == 0; });
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  workReady.notify_all();
+
+  for(std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// One thread is left for the caller, it runs the callbacks
+uint32_t TaskGraph::defaultThreads() {
+  return std::clamp(std::thread::hardware_concurrency(), 2u, 9u) - 1;
+}
+
+Task TaskGraph::add(const char* name, std::initializer_list<Task> dependencies, std::function<void()> work) {
+  return insert(name, dependencies, std::move(work), false);
+}
+
+Task TaskGraph::then(const char* name, std::initializer_list<Task> dependencies, std::function<void()> callback) {
+  return insert(name, dependencies, std::move(callback), true);
+}
+
+Task TaskGraph::insert(const char* name, std::initializer_list<Task> dependencies, std::function<void()> work, bool callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Task task = static_cast<Task>(nodes.size());
+
+  Node& node = nodes.emplace_back();
+  node.name = name;
+  node.work = std::move(work);
+  // Without workers everything would wait for a thread that never comes, so it runs as a callback instead
+  node.callback = callback || workers.empty();
+  node.future = node.promise.get_future().share();
+  ++unfinished;
+
+  for(Task dependency : dependencies) {
+    if(dependency >= task) {
+      continue;
+    }
+
+    if(!nodes[dependency].finished) {
+      nodes[dependency].dependents.push_back(task);
+      ++node.pending;
+    } else if(nodes[dependency].error && !node.error) {
+      node.error = nodes[dependency].error;
+    }
+  }
+
+  if(node.pending == 0) {
+    schedule(task);
+  }
+
+  return task;
+}
+
+// Called with the lock held
+void TaskGraph::schedule(Task task) {
+  if(nodes[task].callback) {
+    callbackQueue.push_back(task);
+    callbackReady.notify_all();
+  } else {
+    workQueue.push_back(task);
+    workReady.notify_one();
+  }
+}
+
+void TaskGraph::execute(Task task) {
+  Node* found;
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    found = &nodes[task];
+    error = found->error;
+  }
+  Node& node = *found;
+
+  // Skipped when something it depends on failed, it would only see half the results
+  if(!error) {
+    PROFILE_ZONE(node.name);
+    try {
+      node.work();
+    } catch(...) {
+      error = std::current_exception();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  node.finished = true;
+  node.work = nullptr;
+  node.error = error;
+  --unfinished;
+
+  if(error) {
+    node.promise.set_exception(error);
+    if(!firstError) {
+      firstError = error;
+    }
+  } else {
+    node.promise.set_value();
+  }
+
+  for(Task dependent : node.dependents) {
+    if(error && !nodes[dependent].error) {
+      nodes[dependent].error = error;
+    }
+
+    if(--nodes[dependent].pending == 0) {
+      schedule(dependent);
+    }
+  }
+
+  // Waiters check their own task, not only the callback queue
+  callbackReady.notify_all();
+}
+
+void TaskGraph::workerLoop() {
+  PROFILE_THREAD("task graph");
+
+  while(true) {
+    Task task;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      workReady.wait(lock, [this] { return stopping || !workQueue.empty(); });
+
+      if(workQueue.empty()) {
+        return;
+      }
+
+      task = workQueue.front();
+      workQueue.pop_front();
+    }
+
+    execute(task);
+  }
+}
+
+std::shared_future<void> TaskGraph::future(Task task) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return nodes[task].future;
+}
+
+bool TaskGraph::done(Task task) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return nodes[task].finished;
+}
+
+size_t TaskGraph::poll() {
+  size_t ran = 0;
+
+  while(true) {
+    Task task;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(callbackQueue.empty()) {
+        return ran;
+      }
+
+      task = callbackQueue.front();
+      callbackQueue.pop_front();
+    }
+
+    execute(task);
+    ++ran;
+  }
+}
+
+void TaskGraph::wait(Task task) {
+  runCallbacksUntil([this, task] { return nodes[task].finished; });
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if(nodes[task].error) {
+    std::rethrow_exception(nodes[task].error);
+  }
+}
+
+void TaskGraph::waitAll() {
+  runCallbacksUntil([this] { return unfinished == 0; });
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if(firstError) {
+    std::rethrow_exception(firstError);
+  }
+}
+
+void TaskGraph::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if(unfinished > 0) {
+    return;
+  }
+
+  nodes.clear();
+  firstError = nullptr;
+}
+
+void TaskGraph::runCallbacksUntil(const std::function<bool()>& finished) {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while(!finished()) {
+    if(callbackQueue.empty()) {
+      callbackReady.wait(lock);
+      continue;
+    }
+
+    Task next = callbackQueue.front();
+    callbackQueue.pop_front();
+
+    lock.unlock();
+    execute(next);
+    lock.lock();
+  }
+}
+} // namespace taskGraph
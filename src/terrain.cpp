@@ -1,6 +1,7 @@
 #include "../include/terrain.hpp"
 
 #include "../include/terrainGeneration.hpp"
+#include "../include/profiler.hpp"
 #include <array>
 #include <cstdint>
 #include <unordered_set>
@@ -8,19 +9,35 @@
 #include <vector>
 
 Terrain::Terrain() {
+  PROFILE_ZONE("Terrain::Terrain");
   std::array<calc::Vec2, 256> v = terrainGeneration::vectors(67);
 
   constexpr float scale = 0.01f;
-  std::vector<Chunk> chunks;
+  this->chunks.reserve(64);
 
   for(int i = 0; i < 8; ++i) {
     for(int j = 0; j < 8; ++j) {
-      chunks.push_back(Chunk(i, 0, j, v, scale));
+      this->chunks.push_back(Chunk(i, 0, j, v, scale));
     }
   }
 
+  for(const Chunk& chunk : this->chunks) {
+    this->bounds.push(chunk.x, chunk.y, chunk.z, chunk.x + 16.0f, chunk.y + 16.0f, chunk.z + 16.0f);
+  }
+
   //terrainGeneration::surfacesFromChunks(vertices, indices, chunks);
-  this->gridyMesher(chunks);
+  this->gridyMesher(this->chunks);
+
+  std::vector<visibility::Connectivity> connectivity;
+  for(const ChunkMesh& mesh : this->meshes) {
+    connectivity.push_back(mesh.connectivity);
+  }
+  this->graph.build(this->chunks, connectivity);
+}
+
+const Chunk* Terrain::chunkAt(int chunkX, int chunkY, int chunkZ) const {
+  int32_t chunk = this->graph.chunkAt(chunkX, chunkY, chunkZ);
+  return chunk < 0 ? nullptr : &this->chunks[chunk];
 }
 
 // FIX: readability
@@ -234,11 +251,9 @@ std::pair<std::vector<Vertex>, std::vector<uint32_t>> mergeSlice(std::array<uint
 
 // TODO: refactor
 void Terrain::gridyMesher(const std::vector<Chunk>& chunks) {
-  this->vertices.clear();
-  this->vertices.reserve(16*16*16*6*4);
-  this->indices.clear();
-  this->indices.reserve(16*16*16*6*6);
-  uint32_t index = 0;
+  PROFILE_ZONE("Terrain::gridyMesher");
+  this->meshes.clear();
+  this->meshes.resize(chunks.size());
   std::unordered_set<uint64_t> us{};
   std::array<std::array<std::array<std::array<uint16_t, 16>, 16>, 6>, 4> slices{};
 
@@ -274,9 +289,15 @@ void Terrain::gridyMesher(const std::vector<Chunk>& chunks) {
     }
   }
 
-  for(const Chunk& chunk : chunks) {
+  for(size_t c = 0; c < chunks.size(); ++c) {
+    const Chunk& chunk = chunks[c];
+    std::vector<Vertex>& vertices = this->meshes[c].vertices;
+    std::vector<uint32_t>& indices = this->meshes[c].indices;
+    uint32_t index = 0;
     slices = {};
 
+    this->meshes[c].connectivity = visibility::faceConnectivity(chunk);
+
     for(int y = 0; y < 16; ++y) {
       for(int x = 0; x < 16; ++x) {
         for(int z = 0; z < 16; ++z) {
@@ -308,40 +329,41 @@ void Terrain::gridyMesher(const std::vector<Chunk>& chunks) {
       }
     }
 
+    // Vertices are local to the chunk, the renderer adds the origin relative to the camera
     for(int i = 0; i < 4; ++i) {
       for(int j = 0; j < 16; ++j) {
-        auto [e, r] = mergeSlice(slices[i][0][j], i, chunk.x, chunk.y + j, chunk.z, Block::mapColor(static_cast<Block::Type>(i)), index, 0);
+        auto [e, r] = mergeSlice(slices[i][0][j], i, 0, j, 0, Block::mapColor(static_cast<Block::Type>(i)), index, 0);
         vertices.insert(vertices.end(), e.begin(), e.end());
         indices.insert(indices.end(), r.begin(), r.end());
       }
       for(int j = 0; j < 16; ++j) {
-        auto [e, r] = mergeSlice(slices[i][1][j], i, chunk.x + j, chunk.y, chunk.z, Block::mapColor(static_cast<Block::Type>(i)), index, 1);
+        auto [e, r] = mergeSlice(slices[i][1][j], i, j, 0, 0, Block::mapColor(static_cast<Block::Type>(i)), index, 1);
         vertices.insert(vertices.end(), e.begin(), e.end());
         indices.insert(indices.end(), r.begin(), r.end());
       }
       for(int j = 0; j < 16; ++j) {
-        auto [e, r] = mergeSlice(slices[i][2][j], i, chunk.x, chunk.y, chunk.z + j, Block::mapColor(static_cast<Block::Type>(i)), index, 2);
+        auto [e, r] = mergeSlice(slices[i][2][j], i, 0, 0, j, Block::mapColor(static_cast<Block::Type>(i)), index, 2);
         vertices.insert(vertices.end(), e.begin(), e.end());
         indices.insert(indices.end(), r.begin(), r.end());
       }
       for(int j = 0; j < 16; ++j) {
-        auto [e, r] = mergeSlice(slices[i][3][j], i, chunk.x, chunk.y + j, chunk.z, Block::mapColor(static_cast<Block::Type>(i)), index, 3);
+        auto [e, r] = mergeSlice(slices[i][3][j], i, 0, j, 0, Block::mapColor(static_cast<Block::Type>(i)), index, 3);
         vertices.insert(vertices.end(), e.begin(), e.end());
         indices.insert(indices.end(), r.begin(), r.end());
       }
       for(int j = 0; j < 16; ++j) {
-        auto [e, r] = mergeSlice(slices[i][4][j], i, chunk.x + j, chunk.y, chunk.z, Block::mapColor(static_cast<Block::Type>(i)), index, 4);
+        auto [e, r] = mergeSlice(slices[i][4][j], i, j, 0, 0, Block::mapColor(static_cast<Block::Type>(i)), index, 4);
         vertices.insert(vertices.end(), e.begin(), e.end());
         indices.insert(indices.end(), r.begin(), r.end());
       }
       for(int j = 0; j < 16; ++j) {
-        auto [e, r] = mergeSlice(slices[i][5][j], i, chunk.x, chunk.y, chunk.z + j, Block::mapColor(static_cast<Block::Type>(i)), index, 5);
+        auto [e, r] = mergeSlice(slices[i][5][j], i, 0, 0, j, Block::mapColor(static_cast<Block::Type>(i)), index, 5);
         vertices.insert(vertices.end(), e.begin(), e.end());
         indices.insert(indices.end(), r.begin(), r.end());
       }
     }
-  }
 
-  this->vertices.shrink_to_fit();
-  this->indices.shrink_to_fit();
+    vertices.shrink_to_fit();
+    indices.shrink_to_fit();
+  }
 }
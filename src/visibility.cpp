@@ -0,0 +1,201 @@
+#include "../include/visibility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace visibility {
+constexpr std::array<std::array<int, 3>, 6> faceSteps = {{
+  {0, -1, 0}, {-1, 0, 0}, {0, 0, -1}, {0, 1, 0}, {1, 0, 0}, {0, 0, 1}
+}};
+
+inline Face opposite(Face face) {
+  return static_cast<Face>((face + 3) % 6);
+}
+
+Connectivity faceConnectivity(const Chunk& chunk) {
+  std::array<bool, 16 * 16 * 16> visited{};
+  std::array<uint16_t, 16 * 16 * 16> queue;
+  Connectivity result = 0;
+
+  for(int start = 0; start < 16 * 16 * 16; ++start) {
+    if(visited[start] || chunk.blocks[start] != Block::Type::Air) {
+      continue;
+    }
+
+    uint8_t faces = 0;
+    size_t head = 0, tail = 0;
+    queue[tail++] = static_cast<uint16_t>(start);
+    visited[start] = true;
+
+    while(head < tail) {
+      int i = queue[head++];
+      int y = i >> 8, x = (i >> 4) & 15, z = i & 15;
+
+      faces |= (y == 0) << NegativeY | (x == 0) << NegativeX | (z == 0) << NegativeZ;
+      faces |= (y == 15) << PositiveY | (x == 15) << PositiveX | (z == 15) << PositiveZ;
+
+      for(const std::array<int, 3>& step : faceSteps) {
+        int nx = x + step[0], ny = y + step[1], nz = z + step[2];
+
+        if(nx < 0 || ny < 0 || nz < 0 || nx > 15 || ny > 15 || nz > 15) {
+          continue;
+        }
+
+        int n = (ny << 8) | (nx << 4) | nz;
+        if(!visited[n] && chunk.blocks[n] == Block::Type::Air) {
+          visited[n] = true;
+          queue[tail++] = static_cast<uint16_t>(n);
+        }
+      }
+    }
+
+    for(int a = 0; a < 6; ++a) {
+      for(int b = 0; b < 6; ++b) {
+        if((faces >> a & 1) && (faces >> b & 1)) {
+          result |= Connectivity(1) << (a * 6 + b);
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+bool connected(Connectivity connectivity, Face a, Face b) {
+  return connectivity >> (a * 6 + b) & 1;
+}
+
+void ChunkGraph::build(const std::vector<Chunk>& chunks, const std::vector<Connectivity>& connectivity) {
+  this->connectivity = connectivity;
+  this->slots.clear();
+
+  if(chunks.empty()) {
+    sizeX = sizeY = sizeZ = 0;
+    return;
+  }
+
+  int maxX = std::numeric_limits<int>::min(), maxY = maxX, maxZ = maxX;
+  minX = minY = minZ = std::numeric_limits<int>::max();
+
+  for(const Chunk& chunk : chunks) {
+    minX = std::min(minX, chunk.x >> 4);
+    minY = std::min(minY, chunk.y >> 4);
+    minZ = std::min(minZ, chunk.z >> 4);
+    maxX = std::max(maxX, chunk.x >> 4);
+    maxY = std::max(maxY, chunk.y >> 4);
+    maxZ = std::max(maxZ, chunk.z >> 4);
+  }
+
+  sizeX = maxX - minX + 1;
+  sizeY = maxY - minY + 1;
+  sizeZ = maxZ - minZ + 1;
+  slots.assign(static_cast<size_t>(sizeX) * sizeY * sizeZ, -1);
+
+  for(size_t i = 0; i < chunks.size(); ++i) {
+    slots[cell((chunks[i].x >> 4) - minX, (chunks[i].y >> 4) - minY, (chunks[i].z >> 4) - minZ)] = static_cast<int32_t>(i);
+  }
+}
+
+int ChunkGraph::cell(int x, int y, int z) const {
+  return (x * sizeY + y) * sizeZ + z;
+}
+
+int32_t ChunkGraph::chunkAt(int chunkX, int chunkY, int chunkZ) const {
+  int gx = chunkX - minX, gy = chunkY - minY, gz = chunkZ - minZ;
+  if(gx < 0 || gy < 0 || gz < 0 || gx >= sizeX || gy >= sizeY || gz >= sizeZ) {
+    return -1;
+  }
+
+  return slots[cell(gx, gy, gz)];
+}
+
+size_t ChunkGraph::potentiallyVisible(float x, float y, float z, std::vector<uint8_t>& visible) const {
+  struct Step {
+    int x, y, z;
+    Face entry;
+    uint8_t directions;
+  };
+
+  visible.assign(connectivity.size(), 0);
+  std::vector<Step> queue;
+  size_t count = 0;
+
+  // A chunk is expanded once per face it is entered from, a later path through a better connected face still gets through it
+  std::vector<uint8_t> entered(connectivity.size(), 0);
+
+  auto visit = [&](int gx, int gy, int gz, Face entry, uint8_t directions) {
+    if(gx < 0 || gy < 0 || gz < 0 || gx >= sizeX || gy >= sizeY || gz >= sizeZ) {
+      return;
+    }
+
+    int32_t chunk = slots[cell(gx, gy, gz)];
+    if(chunk < 0 || entered[chunk] & (1 << entry)) {
+      return;
+    }
+
+    entered[chunk] |= 1 << entry;
+    if(!visible[chunk]) {
+      visible[chunk] = 1;
+      ++count;
+    }
+
+    queue.push_back({gx, gy, gz, entry, directions});
+  };
+
+  int cx = static_cast<int>(std::floor(x / 16.0f)) - minX;
+  int cy = static_cast<int>(std::floor(y / 16.0f)) - minY;
+  int cz = static_cast<int>(std::floor(z / 16.0f)) - minZ;
+
+  if(cx >= 0 && cy >= 0 && cz >= 0 && cx < sizeX && cy < sizeY && cz < sizeZ) {
+    visit(cx, cy, cz, None, 0);
+  } else {
+    // Outside the loaded grid every layer facing the camera is entered from that side
+    for(int a = 0; a < sizeX; ++a) {
+      for(int b = 0; b < sizeZ; ++b) {
+        if(cy >= sizeY) visit(a, sizeY - 1, b, PositiveY, 1 << NegativeY);
+        if(cy < 0) visit(a, 0, b, NegativeY, 1 << PositiveY);
+      }
+      for(int b = 0; b < sizeY; ++b) {
+        if(cz >= sizeZ) visit(a, b, sizeZ - 1, PositiveZ, 1 << NegativeZ);
+        if(cz < 0) visit(a, b, 0, NegativeZ, 1 << PositiveZ);
+      }
+    }
+    for(int a = 0; a < sizeY; ++a) {
+      for(int b = 0; b < sizeZ; ++b) {
+        if(cx >= sizeX) visit(sizeX - 1, a, b, PositiveX, 1 << NegativeX);
+        if(cx < 0) visit(0, a, b, NegativeX, 1 << PositiveX);
+      }
+    }
+  }
+
+  // Nothing to start from, better to draw everything than nothing
+  if(queue.empty()) {
+    std::fill(visible.begin(), visible.end(), 1);
+    return visible.size();
+  }
+
+  for(size_t head = 0; head < queue.size(); ++head) {
+    Step step = queue[head];
+    Connectivity chunkConnectivity = connectivity[slots[cell(step.x, step.y, step.z)]];
+
+    for(int f = 0; f < 6; ++f) {
+      Face exit = static_cast<Face>(f);
+
+      // Never walk back against a direction already taken, keeps the search from leaking around corners
+      if(step.directions & (1 << opposite(exit))) {
+        continue;
+      }
+
+      if(step.entry != None && !connected(chunkConnectivity, step.entry, exit)) {
+        continue;
+      }
+
+      visit(step.x + faceSteps[f][0], step.y + faceSteps[f][1], step.z + faceSteps[f][2], opposite(exit), step.directions | (1 << f));
+    }
+  }
+
+  return count;
+}
+} // namespace visibility